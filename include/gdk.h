@@ -140,7 +140,7 @@ GDK_API int GA_http_request(struct GA_session* session, const GA_json* params, G
  * Refresh the internal cache asset information.
  *
  * :param session: The session to use.
- * :param params: the :ref:`assets-params-data` of the server to connect to.
+ * :param params: the :ref:`assets-params-data` giving the data to return.
  * :param output: Destination for the assets JSON.
  *|     Returned GA_json should be freed using `GA_destroy_json`.
  */
@@ -322,6 +322,33 @@ GDK_API int GA_update_subaccount(struct GA_session* session, const GA_json* deta
  */
 GDK_API int GA_get_transactions(struct GA_session* session, const GA_json* details, struct GA_auth_handler** call);
 
+/**
+ * Create a cursor for iterating the user's transaction history.
+ *
+ * :param session: The session to use.
+ * :param details: :ref:`transactions-cursor-details` giving the subaccount and page size to iterate.
+ * :param output: Destination for the :ref:`transactions-cursor` to pass to `GA_cursor_next`.
+ *|     Returned GA_json should be freed using `GA_destroy_json`.
+ */
+GDK_API int GA_get_transactions_cursor(struct GA_session* session, const GA_json* details, GA_json** output);
+
+/**
+ * Get the next page of the user's transaction history from a cursor.
+ *
+ * :param session: The session to use.
+ * :param cursor: The :ref:`transactions-cursor` returned by `GA_get_transactions_cursor` or a
+ *|     previous call to this function.
+ * :param call: Destination for the resulting GA_auth_handler to complete the action.
+ *|     Returned GA_auth_handler should be freed using `GA_destroy_auth_handler`.
+ *
+ * .. note:: The cursor remains valid across new transaction and block notifications. Transactions
+ *|     are returned from newest to oldest, continuing after the last transaction previously returned.
+ *|     Iterating is not constant-memory: only the returned page is formatted, but the session's
+ *|     transaction cache retains every transaction up to the cursor, so its memory use
+ *|     grows with the number of transactions iterated, as it does for `GA_get_transactions`.
+ */
+GDK_API int GA_cursor_next(struct GA_session* session, const GA_json* cursor, struct GA_auth_handler** call);
+
 /**
  * Get a new address to receive coins to.
  *
@@ -383,6 +410,16 @@ GDK_API int GA_get_unspent_outputs_for_private_key(
 GDK_API int GA_set_unspent_outputs_status(
     struct GA_session* session, const GA_json* details, struct GA_auth_handler** call);
 
+/**
+ * Store blinding nonces obtained from a hardware wallet in the session cache.
+ *
+ * :param session: The session to use.
+ * :param nonces: The :ref:`blinding-nonces` to store.
+ *
+ * .. note:: All nonces are stored in a single cache transaction.
+ */
+GDK_API int GA_set_blinding_nonces(struct GA_session* session, const GA_json* nonces);
+
 /**
  * Get a transaction's details.
  *
@@ -553,6 +590,15 @@ GDK_API int GA_set_transaction_memo(
  */
 GDK_API int GA_get_fee_estimates(struct GA_session* session, GA_json** estimates);
 
+/**
+ * Get usage statistics for the session's local cache.
+ *
+ * :param session: The session to use.
+ * :param output: Destination for the returned :ref:`cache-stats`.
+ *|     Returned GA_json should be freed using `GA_destroy_json`.
+ */
+GDK_API int GA_get_cache_stats(struct GA_session* session, GA_json** output);
+
 /**
  * Get the user's mnemonic passphrase.
  *
@@ -44,6 +44,7 @@ namespace sdk {
         for (uint32_t i = SA_NAMES; i < 32u; ++i) {
             m_data[i] = nlohmann::json();
         }
+        index_tx_memos();
     }
 
     void client_blob::set_user_version(uint64_t version) { m_data[USER_VERSION] = version; }
@@ -76,8 +77,16 @@ namespace sdk {
 
     bool client_blob::set_tx_memo(const std::string& txhash_hex, const std::string& memo)
     {
+        const auto txhash = h2b(txhash_hex);
         const std::string trimmed = boost::algorithm::trim_copy(memo);
         const bool changed = json_add_non_default(m_data[TX_MEMOS], txhash_hex, trimmed);
+        if (changed) {
+            m_tx_memos.erase(txhash);
+            if (!trimmed.empty()) {
+                m_tx_memos.insert(txhash, trimmed);
+            }
+            ++m_tx_memos_version;
+        }
         return changed ? increment_version(m_data) : changed;
     }
 
@@ -86,6 +95,25 @@ namespace sdk {
         return json_get_value(m_data[TX_MEMOS], txhash_hex);
     }
 
+    const std::string* client_blob::get_tx_memo(byte_span_t txhash) const { return m_tx_memos.find(txhash); }
+
+    void client_blob::index_tx_memos()
+    {
+        m_tx_memos.clear();
+        const auto& memos = m_data[TX_MEMOS];
+        if (memos.is_object()) {
+            m_tx_memos.reserve(memos.size());
+            for (const auto& memo : memos.items()) {
+                try {
+                    m_tx_memos.insert(h2b(memo.key()), memo.value().get<std::string>());
+                } catch (const std::exception& e) {
+                    GDK_LOG_SEV(log_level::warning) << "Ignoring invalid tx memo: " << e.what();
+                }
+            }
+        }
+        ++m_tx_memos_version;
+    }
+
     bool client_blob::is_zero_hmac(const std::string& hmac) { return hmac == ZERO_HMAC_BASE64; }
 
     std::string client_blob::compute_hmac(byte_span_t hmac_key, byte_span_t data)
@@ -124,6 +152,7 @@ namespace sdk {
         GDK_RUNTIME_ASSERT_MSG(is_newer, "Server returned an outdated client blob");
 
         m_data.swap(new_data);
+        index_tx_memos();
     }
 
     std::pair<std::vector<unsigned char>, std::string> client_blob::save(byte_span_t key, byte_span_t hmac_key) const
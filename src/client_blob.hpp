@@ -9,6 +9,7 @@
 #include <map>
 #include <memory>
 
+#include "containers.hpp"
 #include "ga_wally.hpp"
 #include <nlohmann/json.hpp>
 
@@ -37,6 +38,10 @@ namespace sdk {
 
         bool set_tx_memo(const std::string& txhash_hex, const std::string& memo);
         std::string get_tx_memo(const std::string& txhash_hex) const;
+        // Get the memo for a binary txhash in display order, or nullptr if it has none
+        const std::string* get_tx_memo(byte_span_t txhash) const;
+        // Changes whenever any tx memo changes, including when a blob is loaded
+        uint64_t get_tx_memos_version() const { return m_tx_memos_version; }
 
         void load(byte_span_t key, byte_span_t data);
         std::pair<std::vector<unsigned char>, std::string> save(byte_span_t key, byte_span_t hmac_key) const;
@@ -45,7 +50,11 @@ namespace sdk {
         static std::string compute_hmac(byte_span_t hmac_key, byte_span_t data);
 
     private:
+        void index_tx_memos();
+
         nlohmann::json m_data;
+        open_hash_map<std::string> m_tx_memos; // Binary txhash to memo
+        uint64_t m_tx_memos_version = 0;
     };
 
 } // namespace sdk
@@ -2,8 +2,14 @@
 #define GDK_CONTAINERS_HPP
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <list>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <vector>
+
+#include "gsl_wrapper.hpp"
 
 namespace ga {
 namespace sdk {
@@ -61,6 +67,237 @@ namespace sdk {
         }
         return *p;
     }
+
+    // A hash map from binary keys to values using open addressing with linear
+    // probing. Intended for short keys such as hashes and scripts, where it
+    // avoids the per-node allocations and pointer chasing of std::unordered_map.
+    // Keys of up to INLINE_KEY_LEN bytes (a txhash and output index) are stored
+    // in the slot; only longer keys are allocated.
+    template <typename V> class open_hash_map final {
+    public:
+        static constexpr size_t INLINE_KEY_LEN = 36;
+
+        using key_span_t = gsl::span<const unsigned char>;
+
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+
+        void clear()
+        {
+            std::vector<slot_t>().swap(m_slots);
+            m_size = 0;
+        }
+
+        // Ensure n entries can be held without rehashing
+        void reserve(size_t n)
+        {
+            if (n * 4 > m_slots.size() * 3) {
+                size_t capacity = 16;
+                while (n * 4 > capacity * 3) {
+                    capacity *= 2;
+                }
+                rehash(capacity);
+            }
+        }
+
+        const V* find(key_span_t key) const
+        {
+            if (m_slots.empty()) {
+                return nullptr;
+            }
+            const size_t hash = hash_key(key);
+            const size_t mask = m_slots.size() - 1;
+            for (size_t i = hash & mask;; i = (i + 1) & mask) {
+                const slot_t& slot = m_slots[i];
+                if (!slot.used) {
+                    return nullptr;
+                }
+                if (slot.matches(hash, key)) {
+                    return &slot.value;
+                }
+            }
+        }
+
+        // Insert a value, returning false if the key is already present
+        bool insert(key_span_t key, V value)
+        {
+            reserve(m_size + 1);
+            const size_t hash = hash_key(key);
+            const size_t mask = m_slots.size() - 1;
+            for (size_t i = hash & mask;; i = (i + 1) & mask) {
+                slot_t& slot = m_slots[i];
+                if (!slot.used) {
+                    slot.set_key(key);
+                    slot.value = std::move(value);
+                    slot.hash = hash;
+                    slot.used = true;
+                    ++m_size;
+                    return true;
+                }
+                if (slot.matches(hash, key)) {
+                    return false;
+                }
+            }
+        }
+
+        // Remove a key, returning false if it was not present
+        bool erase(key_span_t key)
+        {
+            if (m_slots.empty()) {
+                return false;
+            }
+            const size_t hash = hash_key(key);
+            const size_t mask = m_slots.size() - 1;
+            size_t i = hash & mask;
+            for (;; i = (i + 1) & mask) {
+                if (!m_slots[i].used) {
+                    return false;
+                }
+                if (m_slots[i].matches(hash, key)) {
+                    break;
+                }
+            }
+            // Shift following entries back into the hole so that no probe
+            // sequence is broken, moving only those whose home slot is not
+            // between the hole and their current position
+            for (size_t j = (i + 1) & mask; m_slots[j].used; j = (j + 1) & mask) {
+                const size_t home = m_slots[j].hash & mask;
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                    m_slots[i] = std::move(m_slots[j]);
+                    i = j;
+                }
+            }
+            m_slots[i] = slot_t();
+            --m_size;
+            return true;
+        }
+
+    private:
+        struct slot_t {
+            key_span_t get_key() const
+            {
+                return key_len <= INLINE_KEY_LEN ? key_span_t(inline_key.data(), key_len) : key_span_t(long_key);
+            }
+
+            void set_key(key_span_t k)
+            {
+                key_len = k.size();
+                if (key_len <= INLINE_KEY_LEN) {
+                    std::copy(k.begin(), k.end(), inline_key.begin());
+                } else {
+                    long_key.assign(k.begin(), k.end());
+                }
+            }
+
+            bool matches(size_t h, key_span_t k) const
+            {
+                if (hash != h || key_len != static_cast<size_t>(k.size())) {
+                    return false;
+                }
+                const auto key = get_key();
+                return std::equal(key.begin(), key.end(), k.begin());
+            }
+
+            std::array<unsigned char, INLINE_KEY_LEN> inline_key;
+            std::vector<unsigned char> long_key; // Only used for keys longer than INLINE_KEY_LEN
+            size_t key_len = 0;
+            V value;
+            size_t hash = 0;
+            bool used = false;
+        };
+
+        static size_t hash_key(key_span_t key)
+        {
+            // FNV-1a
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (const auto c : key) {
+                hash = (hash ^ c) * 0x100000001b3ull;
+            }
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+
+        void rehash(size_t capacity)
+        {
+            std::vector<slot_t> slots(capacity);
+            const size_t mask = capacity - 1;
+            for (auto& slot : m_slots) {
+                if (slot.used) {
+                    size_t i = slot.hash & mask;
+                    while (slots[i].used) {
+                        i = (i + 1) & mask;
+                    }
+                    slots[i] = std::move(slot);
+                }
+            }
+            m_slots.swap(slots);
+        }
+
+        std::vector<slot_t> m_slots;
+        size_t m_size = 0;
+    };
+
+    // A map from binary keys to values holding at most 'max_size' entries.
+    // When full, inserting removes the entry that was least recently found
+    // or inserted.
+    template <typename V> class lru_map final {
+    public:
+        using key_span_t = gsl::span<const unsigned char>;
+
+        explicit lru_map(size_t max_size)
+            : m_max_size(std::max<size_t>(max_size, 1))
+        {
+        }
+
+        size_t size() const { return m_index.size(); }
+        bool empty() const { return m_index.empty(); }
+
+        void clear()
+        {
+            m_index.clear();
+            m_entries.clear();
+        }
+
+        // Find a value, marking it as the most recently used
+        V* find(key_span_t key)
+        {
+            const auto p = m_index.find(key);
+            if (!p) {
+                return nullptr;
+            }
+            m_entries.splice(m_entries.begin(), m_entries, *p);
+            return &(*p)->second;
+        }
+
+        // Insert or replace a value, removing the least recently used if full
+        void insert(key_span_t key, V value)
+        {
+            erase(key);
+            m_entries.emplace_front(std::vector<unsigned char>(key.begin(), key.end()), std::move(value));
+            m_index.insert(key, m_entries.begin());
+            if (m_entries.size() > m_max_size) {
+                m_index.erase(m_entries.back().first);
+                m_entries.pop_back();
+            }
+        }
+
+        // Remove a key, returning false if it was not present
+        bool erase(key_span_t key)
+        {
+            const auto p = m_index.find(key);
+            if (!p) {
+                return false;
+            }
+            m_entries.erase(*p);
+            return m_index.erase(key);
+        }
+
+    private:
+        using entries_t = std::list<std::pair<std::vector<unsigned char>, V>>;
+
+        const size_t m_max_size;
+        entries_t m_entries; // Most recently used first
+        open_hash_map<typename entries_t::iterator> m_index;
+    };
 } // namespace sdk
 } // namespace ga
 
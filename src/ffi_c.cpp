@@ -246,6 +246,9 @@ GDK_DEFINE_C_FUNCTION_2(GA_get_watch_only_username, struct GA_session*, session,
 GDK_DEFINE_C_FUNCTION_2(GA_get_fee_estimates, struct GA_session*, session, GA_json**, estimates,
     { *json_cast(estimates) = new nlohmann::json(session->get_fee_estimates()); })
 
+GDK_DEFINE_C_FUNCTION_2(GA_get_cache_stats, struct GA_session*, session, GA_json**, output,
+    { *json_cast(output) = new nlohmann::json(session->get_cache_stats()); })
+
 GDK_DEFINE_C_FUNCTION_3(GA_get_mnemonic_passphrase, struct GA_session*, session, const char*, password, char**,
     mnemonic, { *mnemonic = to_c_string(session->get_mnemonic_passphrase(password ? password : std::string())); })
 
@@ -317,6 +320,12 @@ GDK_DEFINE_C_FUNCTION_3(GA_get_transactions, struct GA_session*, session, const
     struct GA_auth_handler**, call,
     { *call = auth_cast(new ga::sdk::get_transactions_call(*session, *json_cast(details))); });
 
+GDK_DEFINE_C_FUNCTION_3(GA_get_transactions_cursor, struct GA_session*, session, const GA_json*, details, GA_json**,
+    output, { *json_cast(output) = new nlohmann::json(session->get_transactions_cursor(*json_cast(details))); })
+
+GDK_DEFINE_C_FUNCTION_3(GA_cursor_next, struct GA_session*, session, const GA_json*, cursor, struct GA_auth_handler**,
+    call, { *call = auth_cast(new ga::sdk::cursor_next_call(*session, *json_cast(cursor))); });
+
 GDK_DEFINE_C_FUNCTION_3(GA_get_receive_address, struct GA_session*, session, const GA_json*, details,
     struct GA_auth_handler**, call,
     { *call = auth_cast(new ga::sdk::get_receive_address_call(*session, *json_cast(details))); });
@@ -342,6 +351,9 @@ GDK_DEFINE_C_FUNCTION_5(GA_get_unspent_outputs_for_private_key, struct GA_sessio
             = new nlohmann::json(session->get_unspent_outputs_for_private_key(private_key, password, unused));
     })
 
+GDK_DEFINE_C_FUNCTION_2(GA_set_blinding_nonces, struct GA_session*, session, const GA_json*, nonces,
+    { session->set_blinding_nonces(*json_cast(nonces)); })
+
 GDK_DEFINE_C_FUNCTION_3(GA_get_transaction_details, struct GA_session*, session, const char*, txhash_hex, GA_json**,
     transaction, { *json_cast(transaction) = new nlohmann::json(session->get_transaction_details(txhash_hex)); })
 
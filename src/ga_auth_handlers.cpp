@@ -967,22 +967,15 @@ namespace sdk {
     {
         GDK_RUNTIME_ASSERT(blinded_scripts.size() == nonces.size());
 
+        nlohmann::json rows = nlohmann::json::array();
         size_t i = 0;
-        bool updated = false;
-
         for (const auto& nonce : nonces) {
-            const std::string& pubkey = blinded_scripts.at(i).at("pubkey");
-            const std::string& script = blinded_scripts.at(i).at("script");
-
-            if (!session.has_blinding_nonce(pubkey, script)) {
-                session.set_blinding_nonce(pubkey, script, nonce);
-                updated = true;
-            }
-
+            const auto& blinded_script = blinded_scripts.at(i);
+            rows.push_back({ { "pubkey", blinded_script.at("pubkey") }, { "script", blinded_script.at("script") },
+                { "nonce", nonce } });
             ++i;
         }
-
-        return updated;
+        return session.set_blinding_nonces(rows);
     }
 
     //
@@ -1167,6 +1160,20 @@ namespace sdk {
         return state_type::done;
     }
 
+    //
+    // Get the next page of transactions from a cursor
+    //
+    cursor_next_call::cursor_next_call(session& session, const nlohmann::json& cursor)
+        : needs_unblind_call("get_transactions", session, cursor)
+    {
+    }
+
+    auth_handler::state_type cursor_next_call::wrapped_call_impl()
+    {
+        m_result = m_session.cursor_next(m_details);
+        return state_type::done;
+    }
+
     //
     // Get unspent outputs
     //
@@ -184,6 +184,14 @@ namespace sdk {
         state_type wrapped_call_impl() override;
     };
 
+    class cursor_next_call : public needs_unblind_call {
+    public:
+        cursor_next_call(session& session, const nlohmann::json& cursor);
+
+    private:
+        state_type wrapped_call_impl() override;
+    };
+
     class get_unspent_outputs_call : public needs_unblind_call {
     public:
         get_unspent_outputs_call(session& session, const nlohmann::json& details);
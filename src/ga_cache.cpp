@@ -1,30 +1,128 @@
 #include <algorithm>
 #include <array>
 #include <fstream>
+#include <numeric>
+#include <set>
 #include <vector>
 
 #include "assertion.hpp"
 #include "ga_cache.hpp"
 #include "logging.hpp"
+#include "memory.hpp"
 #include "network_parameters.hpp"
 #include "session.hpp"
 #include "sqlite3/sqlite3.h"
+#include "threading.hpp"
 #include "utils.hpp"
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace ga {
 namespace sdk {
 
     namespace {
 
-        constexpr int VERSION = 1;
+        constexpr int VERSION = 2;
+        constexpr uint32_t DEFAULT_WRITE_DELAY_MS = 1000;
+        constexpr uint64_t DEFAULT_MAX_LIQUID_ROWS = 50000;
+        // Upper bound of the first latency histogram bucket, in microseconds
+        constexpr uint64_t LATENCY_BUCKET_US = 1000;
+        // Compact the database once this fraction (1/N) of its pages are unused
+        constexpr int64_t COMPACT_FREE_PAGE_RATIO = 4;
         constexpr const char* KV_SELECT = "SELECT value FROM KeyValue WHERE key = ?1;";
 
+        // From version 2, the database image is stored as a log of
+        // individually encrypted records. Each record is either a page
+        // of the image or a commit giving the image size at that point.
+        // Saving appends only the pages that changed since the last save
+        // followed by a commit, and loading replays the log up to the last
+        // complete commit. Records are framed by their encrypted length and
+        // page index; the encrypted part repeats the index along with the
+        // log id and sequence number so records cannot be moved or replayed.
+        // The log is rewritten from scratch once appending would make it
+        // LOG_COMPACT_RATIO times the size of a fresh copy.
+        constexpr size_t LOG_PAGE_SIZE = 4096;
+        constexpr uint32_t COMMIT_INDEX = 0xffffffff;
+        constexpr size_t LOG_ID_LEN = 16;
+        constexpr size_t LOG_COMPACT_RATIO = 2;
+        constexpr size_t RECORD_HEADER_LEN = sizeof(uint32_t) * 2;
+        constexpr size_t RECORD_PREFIX_LEN = LOG_ID_LEN + sizeof(uint64_t) + sizeof(uint32_t);
+        // Upper bound on the size of a record, including the AES-GCM IV and tag
+        constexpr size_t RECORD_LEN = RECORD_HEADER_LEN + RECORD_PREFIX_LEN + 12 + 16 + LOG_PAGE_SIZE;
+
         static cache::sqlite3_ptr get_new_memory_db()
         {
             sqlite3* tmpdb = nullptr;
             const int rc = sqlite3_open(":memory:", &tmpdb);
             GDK_RUNTIME_ASSERT(rc == SQLITE_OK);
-            return cache::sqlite3_ptr{ tmpdb, [](sqlite3* p) { sqlite3_free(p); } };
+            return cache::sqlite3_ptr{ tmpdb, [](sqlite3* p) { sqlite3_close(p); } };
+        }
+
+        static void exec_check(cache::sqlite3_ptr& db, const char* sql)
+        {
+            char* err_msg = nullptr;
+            const int rc = sqlite3_exec(db.get(), sql, 0, 0, &err_msg);
+            if (rc != SQLITE_OK) {
+                GDK_LOG_SEV(log_level::info) << "Bad exec_check RC " << rc << " err_msg: " << err_msg;
+                sqlite3_free(err_msg);
+                GDK_RUNTIME_ASSERT(false);
+            }
+        }
+
+        // Create any tables missing from db, which may have been loaded from
+        // a file written before they were added
+        static void create_tables(cache::sqlite3_ptr& db)
+        {
+            exec_check(db,
+                "CREATE TABLE IF NOT EXISTS LiquidOutput(txid BLOB NOT NULL, vout INTEGER NOT NULL, assetid BLOB NOT "
+                "NULL, satoshi INTEGER NOT NULL, abf BLOB NOT NULL, vbf BLOB NOT NULL, PRIMARY KEY (txid, vout));");
+
+            exec_check(
+                db, "CREATE TABLE IF NOT EXISTS KeyValue(key BLOB NOT NULL, value BLOB NOT NULL, PRIMARY KEY(key));");
+
+            exec_check(db,
+                "CREATE TABLE IF NOT EXISTS LiquidBlindingNonce(pubkey BLOB NOT NULL, script BLOB NOT NULL, nonce BLOB "
+                "NOT NULL, PRIMARY KEY(pubkey, script));");
+
+            exec_check(db,
+                "CREATE TABLE IF NOT EXISTS LiquidUnblindFailure(pubkey BLOB NOT NULL, script BLOB NOT NULL, txid BLOB "
+                "NOT NULL, vout INTEGER NOT NULL, PRIMARY KEY(txid, vout));");
+
+            // Failures are looked up by nonce key whenever a nonce is inserted
+            exec_check(db,
+                "CREATE INDEX IF NOT EXISTS LiquidUnblindFailureNonce ON LiquidUnblindFailure(pubkey, script);");
+
+            // The unspent outputs of each subaccount, whose outputs and nonces
+            // are not evicted. pubkey and script are NULL for outputs without a nonce
+            exec_check(db,
+                "CREATE TABLE IF NOT EXISTS LiquidUnspentOutput(subaccount INTEGER NOT NULL, txid BLOB NOT NULL, vout "
+                "INTEGER NOT NULL, pubkey BLOB, script BLOB, PRIMARY KEY(txid, vout));");
+
+            exec_check(db,
+                "CREATE INDEX IF NOT EXISTS LiquidUnspentOutputNonce ON LiquidUnspentOutput(pubkey, script);");
+
+            exec_check(db,
+                "CREATE TABLE IF NOT EXISTS TxList(subaccount INTEGER NOT NULL, ordinal INTEGER NOT NULL, tx BLOB NOT "
+                "NULL, PRIMARY KEY(subaccount, ordinal));");
+
+            exec_check(db,
+                "CREATE TABLE IF NOT EXISTS TxListState(subaccount INTEGER NOT NULL, oldest_txhash TEXT NOT NULL, "
+                "PRIMARY KEY(subaccount));");
+
+            exec_check(db,
+                "CREATE TABLE IF NOT EXISTS AssetRegistry(type BLOB NOT NULL, asset_id BLOB NOT NULL, value BLOB NOT "
+                "NULL, PRIMARY KEY(type, asset_id));");
+
+            exec_check(db,
+                "CREATE TABLE IF NOT EXISTS AddressScript(subaccount INTEGER NOT NULL, pointer INTEGER NOT NULL, "
+                "branch INTEGER NOT NULL, type INTEGER NOT NULL, subtype INTEGER NOT NULL, script BLOB NOT NULL, "
+                "ga_pubkey BLOB NOT NULL, user_pubkey BLOB NOT NULL, "
+                "PRIMARY KEY(subaccount, pointer, branch, type, subtype));");
         }
 
         static auto get_db()
@@ -33,22 +131,7 @@ namespace sdk {
             GDK_RUNTIME_ASSERT(sqlite3_threadsafe());
 
             auto db = get_new_memory_db();
-            const auto exec_check = [&db](const char* sql) {
-                char* err_msg = nullptr;
-                const int rc = sqlite3_exec(db.get(), sql, 0, 0, &err_msg);
-                if (rc != SQLITE_OK) {
-                    GDK_LOG_SEV(log_level::info) << "Bad exec_check RC " << rc << " err_msg: " << err_msg;
-                    GDK_RUNTIME_ASSERT(false);
-                }
-            };
-            exec_check("CREATE TABLE LiquidOutput(txid BLOB NOT NULL, vout INTEGER NOT NULL, assetid BLOB NOT NULL, "
-                       "satoshi INTEGER NOT NULL, abf BLOB NOT NULL, vbf BLOB NOT NULL, PRIMARY KEY (txid, vout));");
-
-            exec_check("CREATE TABLE KeyValue(key BLOB NOT NULL, value BLOB NOT NULL, PRIMARY KEY(key));");
-
-            exec_check("CREATE TABLE LiquidBlindingNonce(pubkey BLOB NOT NULL, script BLOB NOT NULL, nonce BLOB NOT "
-                       "NULL, PRIMARY KEY(pubkey, script));");
-
+            create_tables(db);
             return db;
         }
 
@@ -85,46 +168,296 @@ namespace sdk {
             return gsl::finally([&stmt] { stmt_check_clean(stmt); });
         }
 
-        static void save_db_file(byte_span_t key, byte_span_t data, const std::string& path)
+        template <typename T> static void put_le(std::vector<unsigned char>& out, T value)
+        {
+            for (size_t i = 0; i < sizeof(T); ++i) {
+                out.push_back(static_cast<unsigned char>(value >> (i * 8)));
+            }
+        }
+
+        template <typename T> static T get_le(const unsigned char* p)
         {
-            GDK_RUNTIME_ASSERT(!key.empty() && !data.empty());
-            std::ofstream f(path, f.out | f.binary);
-            if (f.is_open()) {
-                const size_t encrypted_len = aes_gcm_encrypt_get_length(data);
-                std::vector<unsigned char> cyphertext(encrypted_len);
-                GDK_RUNTIME_ASSERT(aes_gcm_encrypt(key, data, cyphertext) == encrypted_len);
+            T value = 0;
+            for (size_t i = 0; i < sizeof(T); ++i) {
+                value |= static_cast<T>(p[i]) << (i * 8);
+            }
+            return value;
+        }
+
+        static byte_span_t get_page(byte_span_t image, size_t index)
+        {
+            const size_t start = index * LOG_PAGE_SIZE;
+            return image.subspan(start, std::min(LOG_PAGE_SIZE, image.size() - start));
+        }
+
+        static void add_record(std::vector<unsigned char>& out, byte_span_t key, const cache::page_log& log,
+            uint32_t index, byte_span_t body)
+        {
+            std::vector<unsigned char> plaintext(log.id.begin(), log.id.end());
+            plaintext.reserve(RECORD_PREFIX_LEN + body.size());
+            put_le<uint64_t>(plaintext, log.sequence);
+            put_le<uint32_t>(plaintext, index);
+            plaintext.insert(plaintext.end(), body.begin(), body.end());
+
+            const size_t encrypted_len = aes_gcm_encrypt_get_length(plaintext);
+            put_le<uint32_t>(out, encrypted_len);
+            put_le<uint32_t>(out, index);
+            out.resize(out.size() + encrypted_len);
+            const auto cyphertext = gsl::make_span(out).subspan(out.size() - encrypted_len);
+            GDK_RUNTIME_ASSERT(aes_gcm_encrypt(key, plaintext, cyphertext) == encrypted_len);
+        }
+
+        static void save_db_log(byte_span_t key, byte_span_t image, const std::string& path, cache::page_log& log)
+        {
+            GDK_RUNTIME_ASSERT(!key.empty() && !image.empty());
+            const size_t num_pages = (image.size() + LOG_PAGE_SIZE - 1) / LOG_PAGE_SIZE;
+            GDK_RUNTIME_ASSERT(num_pages < COMMIT_INDEX);
+
+            std::vector<cache::page_hash_t> hashes;
+            hashes.reserve(num_pages);
+            std::vector<uint32_t> dirty;
+            for (size_t i = 0; i < num_pages; ++i) {
+                hashes.emplace_back(sha256(get_page(image, i)));
+                if (i >= log.page_hashes.size() || hashes.back() != log.page_hashes[i]) {
+                    dirty.push_back(i);
+                }
+            }
+
+            // Rewrite the log if it doesn't exist yet, or if appending would
+            // grow it too far beyond the size of a fresh copy
+            const size_t full_len = (num_pages + 1) * RECORD_LEN;
+            const size_t append_len = (dirty.size() + 1) * RECORD_LEN;
+            std::ofstream f;
+            if (log.size + append_len > full_len * LOG_COMPACT_RATIO) {
+                log.size = 0; // Too large: compact by rewriting
+            }
+            if (log.size != 0) {
+                f.open(path, f.out | f.binary | f.app);
+                f.seekp(0, f.end);
+                if (!f.is_open() || static_cast<uint64_t>(f.tellp()) != log.size) {
+                    // The file has been changed or removed underneath us
+                    f.close();
+                    log.size = 0;
+                }
+            }
+            if (log.size == 0) {
+                log.id = get_random_bytes<LOG_ID_LEN>();
+                log.sequence = 0;
+                dirty.resize(num_pages);
+                std::iota(dirty.begin(), dirty.end(), 0);
+                f.open(path, f.out | f.binary | f.trunc);
+            }
+            if (!f.is_open()) {
+                return;
+            }
+
+            std::vector<unsigned char> records;
+            records.reserve((dirty.size() + 1) * RECORD_LEN);
+            for (const auto index : dirty) {
+                add_record(records, key, log, index, get_page(image, index));
+                ++log.sequence;
+            }
+            std::vector<unsigned char> commit;
+            put_le<uint64_t>(commit, image.size());
+            add_record(records, key, log, COMMIT_INDEX, commit);
+            ++log.sequence;
+
+            // Until the write succeeds, force the next save to rewrite the log
+            const uint64_t log_size = log.size;
+            log.size = 0;
+            log.page_hashes.clear();
+            f.write(reinterpret_cast<const char*>(records.data()), records.size());
+            f.flush();
+            if (f.good()) {
+                log.size = log_size + records.size();
+                log.page_hashes.swap(hashes);
+            }
+        }
+
+        // A read-only view of a file's contents, memory mapped where supported
+        class file_view final {
+        public:
+            explicit file_view(const std::string& path)
+                : m_data(nullptr)
+                , m_size(0)
+            {
+#ifndef WIN32
+                const int fd = open(path.c_str(), O_RDONLY);
+                if (fd != -1) {
+                    struct stat st;
+                    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                        if (p != MAP_FAILED) {
+                            madvise(p, st.st_size, MADV_SEQUENTIAL);
+                            m_data = reinterpret_cast<const unsigned char*>(p);
+                            m_size = st.st_size;
+                        }
+                    }
+                    close(fd);
+                    if (m_data) {
+                        return;
+                    }
+                }
+#endif
+                std::ifstream f(path, f.in | f.binary);
+                if (!f.is_open()) {
+                    GDK_LOG_SEV(log_level::info) << "Load db, no file or bad file " << path;
+                    return;
+                }
+
+                f.seekg(0, f.end);
+                m_contents.resize(f.tellg());
+                f.seekg(0, f.beg);
+
+                size_t read = 0;
+                while (read != m_contents.size()) {
+                    auto p = reinterpret_cast<char*>(&m_contents[read]);
+                    f.read(p, m_contents.size() - read);
+                    read += f.gcount();
+                }
+            }
 
-                for (size_t written = 0; written != encrypted_len; written = f.tellp()) {
-                    auto p = reinterpret_cast<const char*>(&cyphertext[written]);
-                    f.write(p, encrypted_len - written);
+            ~file_view()
+            {
+#ifndef WIN32
+                if (m_data) {
+                    munmap(const_cast<unsigned char*>(m_data), m_size);
                 }
+#endif
             }
+
+            file_view(const file_view&) = delete;
+            file_view& operator=(const file_view&) = delete;
+
+            byte_span_t get() const
+            {
+                return m_data ? gsl::make_span(m_data, m_size) : gsl::make_span(m_contents);
+            }
+
+        private:
+            const unsigned char* m_data;
+            size_t m_size;
+            std::vector<unsigned char> m_contents;
+        };
+
+        // A database image in memory allocated by sqlite, so that sqlite can
+        // take ownership of it when it is deserialized
+        struct db_image {
+            db_image()
+                : data(nullptr, sqlite3_free)
+                , size(0)
+                , capacity(0)
+            {
+            }
+
+            void allocate(size_t len)
+            {
+                data.reset(reinterpret_cast<unsigned char*>(sqlite3_malloc64(len)));
+                GDK_RUNTIME_ASSERT(data.get() != nullptr);
+                capacity = len;
+            }
+
+            std::unique_ptr<unsigned char, decltype(&sqlite3_free)> data;
+            size_t size;
+            size_t capacity;
+        };
+
+        // Load a version 1 file, which holds the database image as a single encrypted blob
+        static db_image load_db_file(byte_span_t key, const std::string& path)
+        {
+            GDK_RUNTIME_ASSERT(!key.empty());
+            db_image image;
+            const file_view file(path);
+            const auto cyphertext = file.get();
+            if (!cyphertext.empty()) {
+                image.allocate(aes_gcm_decrypt_get_length(cyphertext));
+                const auto plaintext = gsl::make_span(image.data.get(), image.capacity);
+                GDK_RUNTIME_ASSERT(aes_gcm_decrypt(key, cyphertext, plaintext) == image.capacity);
+                image.size = image.capacity;
+            }
+            return image;
         }
 
-        static std::vector<unsigned char> load_db_file(byte_span_t key, const std::string& path)
+        static db_image load_db_log(byte_span_t key, const std::string& path, cache::page_log& log)
         {
             GDK_RUNTIME_ASSERT(!key.empty());
-            std::ifstream f(path, f.in | f.binary);
-            if (!f.is_open()) {
-                GDK_LOG_SEV(log_level::info) << "Load db, no file or bad file " << path;
-                return std::vector<unsigned char>();
+            db_image image;
+            const file_view view(path);
+            const auto file = view.get();
+            const size_t file_size = file.size();
+            if (file.empty()) {
+                return image;
             }
 
-            f.seekg(0, f.end);
-            std::vector<unsigned char> cyphertext(f.tellg());
-            f.seekg(0, f.beg);
+            // Find the end of the last complete commit. Anything after it
+            // is the remains of an interrupted save and is ignored.
+            size_t offset = 0, committed = 0, num_pages = 0, max_pages = 0;
+            while (file_size - offset >= RECORD_HEADER_LEN) {
+                const size_t len = get_le<uint32_t>(&file[offset]);
+                const uint32_t index = get_le<uint32_t>(&file[offset + sizeof(uint32_t)]);
+                if (len > file_size - offset - RECORD_HEADER_LEN) {
+                    break;
+                }
+                offset += RECORD_HEADER_LEN + len;
+                if (index == COMMIT_INDEX) {
+                    committed = offset;
+                    max_pages = num_pages;
+                } else {
+                    num_pages = std::max(num_pages, static_cast<size_t>(index) + 1);
+                }
+            }
+            GDK_RUNTIME_ASSERT_MSG(committed != 0, "No committed data");
+
+            // Replay the committed records in order. Each record is decrypted
+            // into a reused buffer, since it is prefixed with its id, sequence
+            // and index, and its page is copied into the image that sqlite
+            // will take ownership of
+            image.allocate(max_pages * LOG_PAGE_SIZE);
+            std::vector<unsigned char> plaintext;
+            plaintext.reserve(RECORD_PREFIX_LEN + LOG_PAGE_SIZE);
+            log.sequence = 0;
+            for (offset = 0; offset != committed;) {
+                const size_t len = get_le<uint32_t>(&file[offset]);
+                const uint32_t index = get_le<uint32_t>(&file[offset + sizeof(uint32_t)]);
+                const auto cyphertext = file.subspan(offset + RECORD_HEADER_LEN, len);
+                offset += RECORD_HEADER_LEN + len;
+
+                plaintext.resize(aes_gcm_decrypt_get_length(cyphertext));
+                GDK_RUNTIME_ASSERT(aes_gcm_decrypt(key, cyphertext, plaintext) == plaintext.size());
+                GDK_RUNTIME_ASSERT(plaintext.size() > RECORD_PREFIX_LEN);
+                if (log.sequence == 0) {
+                    std::copy(plaintext.begin(), plaintext.begin() + LOG_ID_LEN, log.id.begin());
+                }
+                GDK_RUNTIME_ASSERT(std::equal(log.id.begin(), log.id.end(), plaintext.begin()));
+                GDK_RUNTIME_ASSERT(get_le<uint64_t>(&plaintext[LOG_ID_LEN]) == log.sequence);
+                GDK_RUNTIME_ASSERT(get_le<uint32_t>(&plaintext[LOG_ID_LEN + sizeof(uint64_t)]) == index);
+                ++log.sequence;
 
-            size_t read = 0;
-            while (read != cyphertext.size()) {
-                auto p = reinterpret_cast<char*>(&cyphertext[read]);
-                f.read(p, cyphertext.size() - read);
-                read += f.gcount();
+                const auto body = gsl::make_span(plaintext).subspan(RECORD_PREFIX_LEN);
+                const size_t body_len = body.size();
+                if (index == COMMIT_INDEX) {
+                    GDK_RUNTIME_ASSERT(body_len == sizeof(uint64_t));
+                    const uint64_t db_size = get_le<uint64_t>(body.data());
+                    GDK_RUNTIME_ASSERT(db_size <= image.capacity);
+                    image.size = db_size;
+                } else {
+                    GDK_RUNTIME_ASSERT(body_len <= LOG_PAGE_SIZE);
+                    const size_t start = static_cast<size_t>(index) * LOG_PAGE_SIZE;
+                    GDK_RUNTIME_ASSERT(start + body_len <= image.capacity);
+                    std::copy(body.begin(), body.end(), image.data.get() + start);
+                }
             }
 
-            const size_t decrypted_len = aes_gcm_decrypt_get_length(cyphertext);
-            std::vector<unsigned char> plaintext(decrypted_len);
-            GDK_RUNTIME_ASSERT(aes_gcm_decrypt(key, cyphertext, plaintext) == decrypted_len);
-            return plaintext;
+            const auto image_span = gsl::make_span(image.data.get(), image.size);
+            num_pages = (image.size + LOG_PAGE_SIZE - 1) / LOG_PAGE_SIZE;
+            log.page_hashes.clear();
+            log.page_hashes.reserve(num_pages);
+            for (size_t i = 0; i < num_pages; ++i) {
+                log.page_hashes.emplace_back(sha256(get_page(image_span, i)));
+            }
+            // Saves can only be appended if there is nothing after the last commit
+            log.size = committed == file_size ? committed : 0;
+            return image;
         }
 
         static std::string get_persistent_storage_file(
@@ -148,35 +481,42 @@ namespace sdk {
             }
         }
 
-        static bool load_db_impl(byte_span_t key, const std::string& path, cache::sqlite3_ptr& db)
+        static bool load_db_impl(
+            byte_span_t key, const std::string& path, int version, cache::sqlite3_ptr& db, cache::page_log& log)
         {
-            std::vector<unsigned char> plaintext;
+            db_image image;
             try {
-                plaintext = load_db_file(key, path);
+                image = version < 2 ? load_db_file(key, path) : load_db_log(key, path, log);
             } catch (const std::exception& ex) {
                 GDK_LOG_SEV(log_level::info) << "Bad decryption for file " << path << " error " << ex.what();
                 unlink(path.c_str());
             }
 
-            if (plaintext.empty()) {
+            if (image.size == 0) {
                 return false;
             }
 
-            const auto tmpdb = get_new_memory_db();
-            const int rc = sqlite3_deserialize(
-                tmpdb.get(), "main", plaintext.data(), plaintext.size(), plaintext.size(), SQLITE_DESERIALIZE_READONLY);
-
-            if (rc != SQLITE_OK) {
-                GDK_LOG_SEV(log_level::info) << "Bad sqlite3_deserialize for file " << path << " RC " << rc;
-                unlink(path.c_str());
-                return false;
+            // Load the image in place as our database. sqlite owns the image
+            // from this point, and frees it when the database is closed.
+            constexpr auto flags = SQLITE_DESERIALIZE_FREEONCLOSE | SQLITE_DESERIALIZE_RESIZEABLE;
+            const size_t size = image.size, capacity = image.capacity;
+            const int rc = sqlite3_deserialize(db.get(), "main", image.data.release(), size, capacity, flags);
+            bool ok = rc == SQLITE_OK;
+            if (ok) {
+                try {
+                    create_tables(db);
+                } catch (const std::exception&) {
+                    ok = false;
+                }
             }
-
-            auto backup = sqlite3_backup_init(db.get(), "main", tmpdb.get(), "main");
-            bool ok = backup != nullptr && sqlite3_backup_step(backup, -1) == SQLITE_DONE;
-            ok = ok && sqlite3_backup_finish(backup) == SQLITE_OK;
             if (!ok) {
+                GDK_LOG_SEV(log_level::info) << "Bad sqlite3_deserialize for file " << path << " RC " << rc;
                 db_log_error(db.get());
+                unlink(path.c_str());
+                // Start again from an empty database
+                GDK_RUNTIME_ASSERT(sqlite3_deserialize(db.get(), "main", nullptr, 0, 0, 0) == SQLITE_OK);
+                create_tables(db);
+                log.size = 0;
                 return false;
             }
             GDK_LOG_SEV(log_level::info) << path << " loaded correctly";
@@ -188,6 +528,19 @@ namespace sdk {
             GDK_RUNTIME_ASSERT(sqlite3_step(stmt.get()) == SQLITE_DONE);
         }
 
+        // Run fn inside a single transaction, rolling back if it throws
+        template <typename FN> static void in_transaction(cache::sqlite3_ptr& db, FN&& fn)
+        {
+            exec_check(db, "BEGIN;");
+            try {
+                fn();
+            } catch (const std::exception&) {
+                sqlite3_exec(db.get(), "ROLLBACK;", 0, 0, nullptr);
+                throw;
+            }
+            exec_check(db, "COMMIT;");
+        }
+
         static boost::optional<std::vector<unsigned char>> get_blob(cache::sqlite3_stmt_ptr& stmt, int column)
         {
             const int rc = sqlite3_step(stmt.get());
@@ -203,12 +556,12 @@ namespace sdk {
             return result;
         }
 
-        static void get_blob(cache::sqlite3_stmt_ptr& stmt, int column, const cache::get_key_value_fn& callback)
+        static bool get_blob(cache::sqlite3_stmt_ptr& stmt, int column, const cache::get_key_value_fn& callback)
         {
             const int rc = sqlite3_step(stmt.get());
             if (rc == SQLITE_DONE) {
                 callback(boost::none);
-                return;
+                return false;
             }
             GDK_RUNTIME_ASSERT(rc == SQLITE_ROW);
 
@@ -220,6 +573,7 @@ namespace sdk {
                 GDK_LOG_SEV(log_level::error) << "Blob callback exception: " << ex.what();
             }
             step_final(stmt);
+            return true;
         }
 
         static void bind_blob(cache::sqlite3_stmt_ptr& stmt, int column, byte_span_t blob)
@@ -228,21 +582,61 @@ namespace sdk {
                 sqlite3_bind_blob(stmt.get(), column, blob.data(), blob.size(), SQLITE_STATIC) == SQLITE_OK);
         }
 
+        static void bind_address_key(cache::sqlite3_stmt_ptr& stmt, const cache::address_key_t& key)
+        {
+            GDK_RUNTIME_ASSERT(sqlite3_bind_int64(stmt.get(), 1, key.subaccount) == SQLITE_OK);
+            GDK_RUNTIME_ASSERT(sqlite3_bind_int64(stmt.get(), 2, key.pointer) == SQLITE_OK);
+            GDK_RUNTIME_ASSERT(sqlite3_bind_int64(stmt.get(), 3, key.branch) == SQLITE_OK);
+            GDK_RUNTIME_ASSERT(sqlite3_bind_int64(stmt.get(), 4, key.script_type) == SQLITE_OK);
+            GDK_RUNTIME_ASSERT(sqlite3_bind_int64(stmt.get(), 5, key.subtype) == SQLITE_OK);
+        }
+
         static void bind_liquid_blinding(cache::sqlite3_stmt_ptr& stmt, byte_span_t pubkey, byte_span_t script)
         {
             bind_blob(stmt, 1, pubkey);
             bind_blob(stmt, 2, script);
         }
 
-        static bool has_result(cache::sqlite3_stmt_ptr& stmt)
+        static void upsert_blob(cache::sqlite3_stmt_ptr& stmt, const std::string& key, byte_span_t value)
         {
-            const int rc = sqlite3_step(stmt.get());
-            if (rc == SQLITE_DONE) {
-                return false;
-            }
-            GDK_RUNTIME_ASSERT(rc == SQLITE_ROW);
+            GDK_RUNTIME_ASSERT(!key.empty() && !value.empty());
+            const auto _{ stmt_clean(stmt) };
+            bind_blob(stmt, 1, ustring_span(key));
+            bind_blob(stmt, 2, value);
             step_final(stmt);
-            return true;
+        }
+
+        static int64_t get_pragma(cache::sqlite3_ptr& db, const char* pragma)
+        {
+            const std::string sql = std::string("PRAGMA ") + pragma + ";";
+            auto stmt{ get_stmt(true, db, sql.c_str()) };
+            GDK_RUNTIME_ASSERT(sqlite3_step(stmt.get()) == SQLITE_ROW);
+            return sqlite3_column_int64(stmt.get(), 0);
+        }
+
+        static byte_span_t column_blob(cache::sqlite3_stmt_ptr& stmt, int column)
+        {
+            const auto res = reinterpret_cast<const unsigned char*>(sqlite3_column_blob(stmt.get(), column));
+            return gsl::make_span(res, sqlite3_column_bytes(stmt.get(), column));
+        }
+
+        // Keys for the in-memory Liquid tables
+        static std::vector<unsigned char> liquid_output_key(byte_span_t txhash, uint32_t vout)
+        {
+            std::vector<unsigned char> key(txhash.begin(), txhash.end());
+            put_le<uint32_t>(key, vout);
+            return key;
+        }
+
+        static std::vector<unsigned char> liquid_blinding_nonce_key(byte_span_t pubkey, byte_span_t script)
+        {
+            GDK_RUNTIME_ASSERT(pubkey.size() < 256);
+            std::vector<unsigned char> key;
+            key.reserve(1 + pubkey.size() + script.size());
+            key.push_back(static_cast<unsigned char>(pubkey.size()));
+            key.insert(key.end(), pubkey.begin(), pubkey.end());
+            key.insert(key.end(), script.begin(), script.end());
+            return key;
         }
     } // namespace
 
@@ -254,31 +648,141 @@ namespace sdk {
         , m_db_name()
         , m_encryption_key()
         , m_require_write(false)
+        , m_log()
+        , m_write_delay(0)
+        , m_write_requested()
+        , m_write_pending(false)
+        , m_writing(false)
+        , m_flush_requested(false)
+        , m_stop_writer(false)
+        , m_pending_writes(0)
+        , m_total_writes(0)
+        , m_coalesced_writes(0)
+        , m_last_write_latency(0)
+        , m_write_latency()
+        , m_load_latency()
+        , m_liquid_output_stats()
+        , m_liquid_blinding_nonce_stats()
+        , m_liquid_unblind_failure_stats()
+        , m_key_value_stats()
+        , m_tx_list_stats()
+        , m_registry_stats()
+        , m_address_script_stats()
+        , m_max_liquid_rows(0)
+        , m_evicted_outputs(0)
+        , m_evicted_nonces(0)
+        , m_evicted_unblind_failures(0)
+        , m_vacuums(0)
+        , m_vacuumed_bytes(0)
+        , m_liquid_outputs()
+        , m_liquid_blinding_nonces()
+        , m_liquid_unblind_failures()
         , m_db(get_db())
-        , m_stmt_liquid_blinding_nonce_has(get_stmt(
-              m_is_liquid, m_db, "SELECT 1 FROM LiquidBlindingNonce WHERE pubkey = ?1 AND script = ?2 LIMIT 1;"))
-        , m_stmt_liquid_blinding_nonce_search(
-              get_stmt(m_is_liquid, m_db, "SELECT nonce FROM LiquidBlindingNonce WHERE pubkey = ?1 AND script = ?2;"))
-        , m_stmt_liquid_blinding_nonce_insert(get_stmt(
-              m_is_liquid, m_db, "INSERT INTO LiquidBlindingNonce (pubkey, script, nonce) VALUES (?1, ?2, ?3);"))
-        , m_stmt_liquid_output_has(
-              get_stmt(m_is_liquid, m_db, "SELECT 1 FROM LiquidOutput WHERE txid = ?1 AND vout = ?2 LIMIT 1;"))
-        , m_stmt_liquid_output_search(get_stmt(
-              m_is_liquid, m_db, "SELECT assetid, satoshi, abf, vbf FROM LiquidOutput WHERE txid = ?1 AND vout = ?2;"))
+        , m_stmt_liquid_blinding_nonce_insert(get_stmt(m_is_liquid, m_db,
+              "INSERT OR IGNORE INTO LiquidBlindingNonce (pubkey, script, nonce) VALUES (?1, ?2, ?3);"))
+        , m_stmt_liquid_blinding_nonce_delete(
+              get_stmt(m_is_liquid, m_db, "DELETE FROM LiquidBlindingNonce WHERE pubkey = ?1 AND script = ?2;"))
         , m_stmt_liquid_output_insert(get_stmt(m_is_liquid, m_db,
-              "INSERT INTO LiquidOutput (txid, vout, assetid, satoshi, abf, vbf) VALUES (?1, ?2, ?3, ?4, ?5, ?6);"))
+              "INSERT OR IGNORE INTO LiquidOutput (txid, vout, assetid, satoshi, abf, vbf) "
+              "VALUES (?1, ?2, ?3, ?4, ?5, ?6);"))
+        , m_stmt_liquid_output_delete(
+              get_stmt(m_is_liquid, m_db, "DELETE FROM LiquidOutput WHERE txid = ?1 AND vout = ?2;"))
+        , m_stmt_liquid_unblind_failure_insert(get_stmt(m_is_liquid, m_db,
+              "INSERT OR IGNORE INTO LiquidUnblindFailure (pubkey, script, txid, vout) VALUES (?1, ?2, ?3, ?4);"))
+        , m_stmt_liquid_unblind_failure_search(get_stmt(
+              m_is_liquid, m_db, "SELECT txid, vout FROM LiquidUnblindFailure WHERE pubkey = ?1 AND script = ?2;"))
+        , m_stmt_liquid_unblind_failure_delete(
+              get_stmt(m_is_liquid, m_db, "DELETE FROM LiquidUnblindFailure WHERE pubkey = ?1 AND script = ?2;"))
+        , m_stmt_liquid_unspent_search(
+              get_stmt(m_is_liquid, m_db, "SELECT txid, vout FROM LiquidUnspentOutput WHERE subaccount = ?1;"))
+        , m_stmt_liquid_unspent_insert(get_stmt(m_is_liquid, m_db,
+              "INSERT OR REPLACE INTO LiquidUnspentOutput(subaccount, txid, vout, pubkey, script) "
+              "VALUES (?1, ?2, ?3, ?4, ?5);"))
+        , m_stmt_liquid_unspent_clear(
+              get_stmt(m_is_liquid, m_db, "DELETE FROM LiquidUnspentOutput WHERE subaccount = ?1;"))
+        , m_stmt_liquid_unspent_delete(
+              get_stmt(m_is_liquid, m_db, "DELETE FROM LiquidUnspentOutput WHERE txid = ?1 AND vout = ?2;"))
         , m_stmt_key_value_upsert(get_stmt(
               true, m_db, "INSERT INTO KeyValue(key, value) VALUES (?1, ?2) ON CONFLICT(key) DO UPDATE SET value=?2;"))
         , m_stmt_key_value_search(get_stmt(true, m_db, KV_SELECT))
         , m_stmt_key_value_delete(get_stmt(true, m_db, "DELETE FROM KeyValue WHERE key = ?1;"))
+        , m_stmt_tx_list_search(
+              get_stmt(true, m_db, "SELECT ordinal, tx FROM TxList WHERE subaccount = ?1 ORDER BY ordinal DESC;"))
+        , m_stmt_tx_list_upsert(
+              get_stmt(true, m_db, "INSERT OR REPLACE INTO TxList(subaccount, ordinal, tx) VALUES (?1, ?2, ?3);"))
+        , m_stmt_tx_list_trim(get_stmt(
+              true, m_db, "DELETE FROM TxList WHERE subaccount = ?1 AND (ordinal < ?2 OR ordinal > ?3);"))
+        , m_stmt_tx_list_state_search(
+              get_stmt(true, m_db, "SELECT oldest_txhash FROM TxListState WHERE subaccount = ?1;"))
+        , m_stmt_tx_list_state_upsert(get_stmt(
+              true, m_db, "INSERT OR REPLACE INTO TxListState(subaccount, oldest_txhash) VALUES (?1, ?2);"))
+        , m_stmt_registry_search(
+              get_stmt(true, m_db, "SELECT value FROM AssetRegistry WHERE type = ?1 AND asset_id = ?2;"))
+        , m_stmt_registry_search_all(get_stmt(true, m_db, "SELECT asset_id, value FROM AssetRegistry WHERE type = ?1;"))
+        , m_stmt_registry_insert(
+              get_stmt(true, m_db, "INSERT OR REPLACE INTO AssetRegistry(type, asset_id, value) VALUES (?1, ?2, ?3);"))
+        , m_stmt_registry_clear(get_stmt(true, m_db, "DELETE FROM AssetRegistry WHERE type = ?1;"))
+        , m_stmt_address_script_search(get_stmt(true, m_db,
+              "SELECT script, ga_pubkey, user_pubkey FROM AddressScript WHERE subaccount = ?1 AND pointer = ?2 "
+              "AND branch = ?3 AND type = ?4 AND subtype = ?5;"))
+        , m_stmt_address_script_insert(get_stmt(true, m_db,
+              "INSERT OR IGNORE INTO AddressScript(subaccount, pointer, branch, type, subtype, script, ga_pubkey, "
+              "user_pubkey) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8);"))
     {
     }
 
+    cache::~cache()
+    {
+        no_std_exception_escape([this] {
+            locker_t locker(m_mutex);
+            flush_impl(locker);
+            m_stop_writer = true;
+            m_write_cv.notify_all();
+        });
+        if (m_writer.joinable()) {
+            m_writer.join();
+        }
+    }
+
     void cache::save_db()
     {
+        locker_t locker(m_mutex);
         if (m_db_name.empty() || !m_require_write) {
             return;
         }
+        if (!m_writer.joinable()) {
+            // No write delay: write synchronously
+            write_db(locker);
+            return;
+        }
+        if (!m_write_pending) {
+            m_write_pending = true;
+            m_write_requested = std::chrono::steady_clock::now();
+        }
+        ++m_pending_writes;
+        m_write_cv.notify_all();
+    }
+
+    void cache::flush()
+    {
+        locker_t locker(m_mutex);
+        flush_impl(locker);
+    }
+
+    void cache::flush_impl(locker_t& locker)
+    {
+        GDK_RUNTIME_ASSERT(locker.owns_lock());
+        if (m_write_pending || m_writing) {
+            m_flush_requested = true;
+            m_write_cv.notify_all();
+            m_write_cv.wait(locker, [this] { return !m_write_pending && !m_writing; });
+        }
+    }
+
+    void cache::write_db(locker_t& locker)
+    {
+        GDK_RUNTIME_ASSERT(locker.owns_lock());
+        const auto start = std::chrono::steady_clock::now();
         sqlite3_int64 db_size;
         void* db = sqlite3_serialize(m_db.get(), "main", &db_size, 0);
         const auto _stmt_clean = gsl::finally([&db] { sqlite3_free(db); });
@@ -287,20 +791,116 @@ namespace sdk {
         }
         const auto data = gsl::make_span(reinterpret_cast<const unsigned char*>(db), db_size);
         const auto path = get_persistent_storage_file(m_data_dir, m_db_name, VERSION);
-        save_db_file(m_encryption_key, data, path);
+        const auto key = m_encryption_key;
         m_require_write = false;
+        if (m_writing) {
+            // On the writer thread: allow the cache to be used while we
+            // encrypt and write our copy of the database. Only the writer
+            // thread touches m_log while m_writing is set.
+            unique_unlock unlocker(locker);
+            save_db_log(key, data, path, m_log);
+        } else {
+            save_db_log(key, data, path, m_log);
+        }
+        ++m_total_writes;
+        m_last_write_latency
+            = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        m_write_latency.add(m_last_write_latency);
+    }
+
+    void cache::writer_thread_fn()
+    {
+        locker_t locker(m_mutex);
+        for (;;) {
+            m_write_cv.wait(locker, [this] { return m_write_pending || m_stop_writer; });
+            if (!m_write_pending) {
+                break; // Stopped with nothing left to write
+            }
+            // Wait for the write delay to pass, so that any further saves
+            // requested in the meantime are coalesced into a single write
+            const auto deadline = m_write_requested + m_write_delay;
+            m_write_cv.wait_until(locker, deadline, [this] { return m_flush_requested || m_stop_writer; });
+
+            m_coalesced_writes += m_pending_writes - 1;
+            m_pending_writes = 0;
+            m_write_pending = false;
+            m_flush_requested = false;
+            m_writing = true;
+            no_std_exception_escape([this, &locker] { write_db(locker); });
+            m_writing = false;
+            m_write_cv.notify_all();
+        }
+    }
+
+    nlohmann::json cache::table_stats::to_json() const
+    {
+        return { { "hits", hits }, { "misses", misses }, { "inserts", inserts }, { "bytes", bytes } };
+    }
+
+    void cache::latency_histogram::add(std::chrono::microseconds latency)
+    {
+        const uint64_t us = latency.count();
+        size_t bucket = 0;
+        for (uint64_t bound = LATENCY_BUCKET_US; bucket < NUM_BUCKETS - 1 && us >= bound; bound *= 4) {
+            ++bucket;
+        }
+        ++counts[bucket];
+        total_us += us;
+        max_us = std::max(max_us, us);
+    }
+
+    nlohmann::json cache::latency_histogram::to_json() const
+    {
+        // Buckets are keyed by their upper bound in microseconds
+        nlohmann::json buckets;
+        uint64_t bound = LATENCY_BUCKET_US;
+        for (size_t i = 0; i < NUM_BUCKETS; ++i, bound *= 4) {
+            buckets[i == NUM_BUCKETS - 1 ? std::string("inf") : std::to_string(bound)] = counts[i];
+        }
+        return { { "count", std::accumulate(counts.begin(), counts.end(), uint64_t(0)) }, { "total_us", total_us },
+            { "max_us", max_us }, { "buckets", buckets } };
+    }
+
+    nlohmann::json cache::get_stats()
+    {
+        locker_t locker(m_mutex);
+        const nlohmann::json tables = { { "liquid_outputs", m_liquid_output_stats.to_json() },
+            { "liquid_blinding_nonces", m_liquid_blinding_nonce_stats.to_json() },
+            { "liquid_unblind_failures", m_liquid_unblind_failure_stats.to_json() },
+            { "key_values", m_key_value_stats.to_json() }, { "tx_lists", m_tx_list_stats.to_json() },
+            { "asset_registry", m_registry_stats.to_json() },
+            { "address_scripts", m_address_script_stats.to_json() } };
+        const nlohmann::json writes = { { "pending_writes", m_pending_writes }, { "writes", m_total_writes },
+            { "coalesced_writes", m_coalesced_writes }, { "last_write_latency_us", m_last_write_latency.count() },
+            { "latency", m_write_latency.to_json() } };
+        const nlohmann::json eviction = { { "evicted_outputs", m_evicted_outputs },
+            { "evicted_nonces", m_evicted_nonces }, { "evicted_unblind_failures", m_evicted_unblind_failures },
+            { "vacuums", m_vacuums }, { "vacuumed_bytes", m_vacuumed_bytes } };
+        return { { "tables", tables }, { "writes", writes }, { "loads", m_load_latency.to_json() },
+            { "eviction", eviction } };
     }
 
     void cache::load_db(byte_span_t encryption_key, const uint32_t type)
     {
         GDK_RUNTIME_ASSERT(!encryption_key.empty());
 
+        locker_t locker(m_mutex);
+        flush_impl(locker); // Complete any writes to a previously loaded DB
+
         m_data_dir = gdk_config().value("datadir", std::string{});
         if (m_data_dir.empty()) {
             GDK_LOG_SEV(log_level::info) << "datadir not set - thus no get_persistent_storage_file available";
             return;
         }
 
+        m_write_delay = std::chrono::milliseconds(gdk_config().value("cache_write_delay_ms", DEFAULT_WRITE_DELAY_MS));
+        if (m_write_delay.count() > 0 && !m_writer.joinable()) {
+            m_writer = std::thread([this] { writer_thread_fn(); });
+        }
+
+        m_max_liquid_rows = gdk_config().value("cache_max_liquid_rows", DEFAULT_MAX_LIQUID_ROWS);
+
+        const auto start = std::chrono::steady_clock::now();
         m_type = type;
         const auto intermediate = hmac_sha512(encryption_key, ustring_span(m_network_name));
         // Note: the line below means the file name is endian dependant
@@ -309,36 +909,98 @@ namespace sdk {
         m_encryption_key = sha256(encryption_key);
 
         const auto path = get_persistent_storage_file(m_data_dir, m_db_name, VERSION);
-        if (!load_db_impl(m_encryption_key, path, m_db)) {
+        bool is_upgraded = false;
+        if (!load_db_impl(m_encryption_key, path, VERSION, m_db, m_log)) {
             // Failed to load the latest version.
             if (VERSION > 1) {
-                // Try to carry forward our client blob from the previous version
-                try {
-                    const auto prev_path = get_persistent_storage_file(m_data_dir, m_db_name, VERSION - 1);
-                    auto db{ get_db() };
-                    if (load_db_impl(m_encryption_key, prev_path, db)) {
-                        auto stmt{ get_stmt(true, db, KV_SELECT) };
-                        const auto _{ stmt_clean(stmt) };
-                        const char* blob_key = "client_blob";
-                        bind_blob(stmt, 1, ustring_span(blob_key));
-                        auto prev_blob = get_blob(stmt, 0);
-                        if (prev_blob) {
-                            upsert_key_value(blob_key, prev_blob.get());
-                        }
-                        GDK_LOG_SEV(log_level::info) << "Copied client blob from previous version";
-                    }
-                } catch (const std::exception&) {
-                    // Ignore errors; fetch blob from server or recreate instead
+                // The previous version differs only in its file format, so
+                // load it whole as our database, to be rewritten below
+                const auto prev_path = get_persistent_storage_file(m_data_dir, m_db_name, VERSION - 1);
+                page_log prev_log;
+                if (load_db_impl(m_encryption_key, prev_path, VERSION - 1, m_db, prev_log)) {
+                    GDK_LOG_SEV(log_level::info) << "Upgrading db from previous version";
+                    m_log = page_log();
+                    m_require_write = true;
+                    is_upgraded = true;
                 }
             }
 
-            // Clean up old versions only on initial DB creation
+            if (!is_upgraded) {
+                // Clean up old versions only on initial DB creation
+                clean_up_old_db(m_data_dir, m_db_name);
+            }
+        }
+
+        if (m_is_liquid && m_max_liquid_rows) {
+            // Keep only the most recently added outputs, nonces and failures,
+            // along with the outputs and nonces of unspent outputs
+            m_evicted_outputs += evict_oldest(
+                "LiquidOutput", m_max_liquid_rows, "u.txid = LiquidOutput.txid AND u.vout = LiquidOutput.vout");
+            m_evicted_nonces += evict_oldest("LiquidBlindingNonce", m_max_liquid_rows,
+                "u.pubkey = LiquidBlindingNonce.pubkey AND u.script = LiquidBlindingNonce.script");
+            m_evicted_unblind_failures += evict_oldest("LiquidUnblindFailure", m_max_liquid_rows, nullptr);
+        }
+        compact_db();
+        load_liquid_maps();
+        if (is_upgraded) {
+            // Write the current format before removing the previous version
+            write_db(locker);
             clean_up_old_db(m_data_dir, m_db_name);
         }
+        m_load_latency.add(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+    }
+
+    size_t cache::evict_oldest(const char* table, uint64_t max_rows, const char* unspent_match)
+    {
+        // Rows are evicted in insertion (rowid) order, except for rows that
+        // unspent_match finds in LiquidUnspentOutput. Find the newest row
+        // that falls outside the limit, if any.
+        const std::string select_sql
+            = std::string("SELECT rowid FROM ") + table + " ORDER BY rowid DESC LIMIT 1 OFFSET ?1;";
+        auto stmt{ get_stmt(true, m_db, select_sql.c_str()) };
+        GDK_RUNTIME_ASSERT(sqlite3_bind_int64(stmt.get(), 1, max_rows) == SQLITE_OK);
+        const int rc = sqlite3_step(stmt.get());
+        if (rc == SQLITE_DONE) {
+            return 0; // Under the limit
+        }
+        GDK_RUNTIME_ASSERT(rc == SQLITE_ROW);
+        const auto last_rowid = sqlite3_column_int64(stmt.get(), 0);
+
+        std::string delete_sql = std::string("DELETE FROM ") + table + " WHERE rowid <= ?1";
+        if (unspent_match) {
+            delete_sql += std::string(" AND NOT EXISTS (SELECT 1 FROM LiquidUnspentOutput u WHERE ") + unspent_match
+                + ")";
+        }
+        delete_sql += ";";
+        stmt = get_stmt(true, m_db, delete_sql.c_str());
+        GDK_RUNTIME_ASSERT(sqlite3_bind_int64(stmt.get(), 1, last_rowid) == SQLITE_OK);
+        step_final(stmt);
+        const size_t num_evicted = sqlite3_changes(m_db.get());
+        GDK_LOG_SEV(log_level::info) << "Evicted " << num_evicted << " rows from " << table;
+        m_require_write = true;
+        return num_evicted;
+    }
+
+    void cache::compact_db()
+    {
+        const auto page_count = get_pragma(m_db, "page_count");
+        const auto free_pages = get_pragma(m_db, "freelist_count");
+        if (!free_pages || free_pages * COMPACT_FREE_PAGE_RATIO < page_count) {
+            return;
+        }
+        const auto page_size = get_pragma(m_db, "page_size");
+        exec_check(m_db, "VACUUM;");
+        const auto new_page_count = get_pragma(m_db, "page_count");
+        ++m_vacuums;
+        m_vacuumed_bytes += (page_count - new_page_count) * page_size;
+        m_require_write = true;
+        GDK_LOG_SEV(log_level::info) << "Compacted cache from " << page_count << " to " << new_page_count << " pages";
     }
 
     void cache::clear_key_value(const std::string& key)
     {
+        locker_t locker(m_mutex);
         GDK_RUNTIME_ASSERT(!key.empty());
         const auto _{ stmt_clean(m_stmt_key_value_delete) };
         const auto key_span = ustring_span(key);
@@ -348,121 +1010,545 @@ namespace sdk {
 
     void cache::get_key_value(const std::string& key, const cache::get_key_value_fn& callback)
     {
+        locker_t locker(m_mutex);
         GDK_RUNTIME_ASSERT(!key.empty());
         const auto _{ stmt_clean(m_stmt_key_value_search) };
         const auto key_span = ustring_span(key);
         bind_blob(m_stmt_key_value_search, 1, key_span);
-        get_blob(m_stmt_key_value_search, 0, callback);
+        m_key_value_stats.on_lookup(get_blob(m_stmt_key_value_search, 0, callback));
+    }
+
+    std::string cache::get_tx_list(uint32_t subaccount, const cache::get_tx_list_fn& callback)
+    {
+        locker_t locker(m_mutex);
+        {
+            const auto _{ stmt_clean(m_stmt_tx_list_search) };
+            GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_tx_list_search.get(), 1, subaccount) == SQLITE_OK);
+            int rc;
+            bool found = false;
+            while ((rc = sqlite3_step(m_stmt_tx_list_search.get())) == SQLITE_ROW) {
+                callback(sqlite3_column_int64(m_stmt_tx_list_search.get(), 0), column_blob(m_stmt_tx_list_search, 1));
+                found = true;
+            }
+            GDK_RUNTIME_ASSERT(rc == SQLITE_DONE);
+            m_tx_list_stats.on_lookup(found);
+        }
+        const auto _{ stmt_clean(m_stmt_tx_list_state_search) };
+        GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_tx_list_state_search.get(), 1, subaccount) == SQLITE_OK);
+        const auto oldest_txhash = get_blob(m_stmt_tx_list_state_search, 0);
+        return oldest_txhash ? std::string(oldest_txhash->begin(), oldest_txhash->end()) : std::string();
+    }
+
+    void cache::update_tx_list(uint32_t subaccount, int64_t keep_min, int64_t keep_max,
+        gsl::span<const tx_list_row_t> txs, const std::string& oldest_txhash)
+    {
+        locker_t locker(m_mutex);
+        in_transaction(m_db, [&] {
+            {
+                const auto _{ stmt_clean(m_stmt_tx_list_trim) };
+                GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_tx_list_trim.get(), 1, subaccount) == SQLITE_OK);
+                GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_tx_list_trim.get(), 2, keep_min) == SQLITE_OK);
+                GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_tx_list_trim.get(), 3, keep_max) == SQLITE_OK);
+                step_final(m_stmt_tx_list_trim);
+            }
+            for (const auto& tx : txs) {
+                const auto _{ stmt_clean(m_stmt_tx_list_upsert) };
+                GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_tx_list_upsert.get(), 1, subaccount) == SQLITE_OK);
+                GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_tx_list_upsert.get(), 2, tx.first) == SQLITE_OK);
+                bind_blob(m_stmt_tx_list_upsert, 3, tx.second);
+                step_final(m_stmt_tx_list_upsert);
+                m_tx_list_stats.on_insert(tx.second.size());
+            }
+            const auto _{ stmt_clean(m_stmt_tx_list_state_upsert) };
+            GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_tx_list_state_upsert.get(), 1, subaccount) == SQLITE_OK);
+            GDK_RUNTIME_ASSERT(sqlite3_bind_text(m_stmt_tx_list_state_upsert.get(), 2, oldest_txhash.data(),
+                                   oldest_txhash.size(), SQLITE_STATIC)
+                == SQLITE_OK);
+            step_final(m_stmt_tx_list_state_upsert);
+        });
+        m_require_write = true;
+    }
+
+    void cache::clear_tx_lists()
+    {
+        locker_t locker(m_mutex);
+        exec_check(m_db, "DELETE FROM TxList;");
+        exec_check(m_db, "DELETE FROM TxListState;");
+        m_require_write = true;
+    }
+
+    boost::optional<cache::address_script_t> cache::get_address_script(const address_key_t& key)
+    {
+        locker_t locker(m_mutex);
+        const auto _{ stmt_clean(m_stmt_address_script_search) };
+        bind_address_key(m_stmt_address_script_search, key);
+        const int rc = sqlite3_step(m_stmt_address_script_search.get());
+        GDK_RUNTIME_ASSERT(rc == SQLITE_ROW || rc == SQLITE_DONE);
+        m_address_script_stats.on_lookup(rc == SQLITE_ROW);
+        if (rc == SQLITE_DONE) {
+            return boost::none;
+        }
+        address_script_t value;
+        const auto script = column_blob(m_stmt_address_script_search, 0);
+        const auto ga_pub_key = column_blob(m_stmt_address_script_search, 1);
+        const auto user_pub_key = column_blob(m_stmt_address_script_search, 2);
+        GDK_RUNTIME_ASSERT(static_cast<size_t>(ga_pub_key.size()) == value.ga_pub_key.size());
+        GDK_RUNTIME_ASSERT(static_cast<size_t>(user_pub_key.size()) == value.user_pub_key.size());
+        value.script.assign(script.begin(), script.end());
+        std::copy(ga_pub_key.begin(), ga_pub_key.end(), value.ga_pub_key.begin());
+        std::copy(user_pub_key.begin(), user_pub_key.end(), value.user_pub_key.begin());
+        return value;
+    }
+
+    void cache::insert_address_script(const address_key_t& key, const address_script_t& value)
+    {
+        locker_t locker(m_mutex);
+        GDK_RUNTIME_ASSERT(!value.script.empty());
+        const auto _{ stmt_clean(m_stmt_address_script_insert) };
+        bind_address_key(m_stmt_address_script_insert, key);
+        bind_blob(m_stmt_address_script_insert, 6, value.script);
+        bind_blob(m_stmt_address_script_insert, 7, value.ga_pub_key);
+        bind_blob(m_stmt_address_script_insert, 8, value.user_pub_key);
+        step_final(m_stmt_address_script_insert);
+        if (sqlite3_changes(m_db.get())) {
+            m_address_script_stats.on_insert(value.script.size() + sizeof(pub_key_t) * 2);
+            m_require_write = true;
+        }
+    }
+
+    void cache::replace_registry(const std::string& type, gsl::span<const registry_entry_t> entries)
+    {
+        locker_t locker(m_mutex);
+        GDK_RUNTIME_ASSERT(!type.empty());
+        const auto type_span = ustring_span(type);
+        in_transaction(m_db, [&] {
+            {
+                const auto _{ stmt_clean(m_stmt_registry_clear) };
+                bind_blob(m_stmt_registry_clear, 1, type_span);
+                step_final(m_stmt_registry_clear);
+            }
+            for (const auto& entry : entries) {
+                const auto _{ stmt_clean(m_stmt_registry_insert) };
+                bind_blob(m_stmt_registry_insert, 1, type_span);
+                bind_blob(m_stmt_registry_insert, 2, ustring_span(entry.first));
+                bind_blob(m_stmt_registry_insert, 3, entry.second);
+                step_final(m_stmt_registry_insert);
+                m_registry_stats.on_insert(entry.first.size() + entry.second.size());
+            }
+        });
+        m_require_write = true;
+    }
+
+    void cache::get_registry(
+        const std::string& type, gsl::span<const std::string> asset_ids, const get_registry_fn& callback)
+    {
+        locker_t locker(m_mutex);
+        GDK_RUNTIME_ASSERT(!type.empty());
+        const auto type_span = ustring_span(type);
+        if (asset_ids.empty()) {
+            const auto _{ stmt_clean(m_stmt_registry_search_all) };
+            bind_blob(m_stmt_registry_search_all, 1, type_span);
+            int rc;
+            bool found = false;
+            while ((rc = sqlite3_step(m_stmt_registry_search_all.get())) == SQLITE_ROW) {
+                const auto asset_id = column_blob(m_stmt_registry_search_all, 0);
+                callback(std::string(asset_id.begin(), asset_id.end()), column_blob(m_stmt_registry_search_all, 1));
+                found = true;
+            }
+            GDK_RUNTIME_ASSERT(rc == SQLITE_DONE);
+            m_registry_stats.on_lookup(found);
+            return;
+        }
+        for (const auto& asset_id : asset_ids) {
+            const auto _{ stmt_clean(m_stmt_registry_search) };
+            bind_blob(m_stmt_registry_search, 1, type_span);
+            bind_blob(m_stmt_registry_search, 2, ustring_span(asset_id));
+            const int rc = sqlite3_step(m_stmt_registry_search.get());
+            GDK_RUNTIME_ASSERT(rc == SQLITE_ROW || rc == SQLITE_DONE);
+            if (rc == SQLITE_ROW) {
+                callback(asset_id, column_blob(m_stmt_registry_search, 0));
+            }
+            m_registry_stats.on_lookup(rc == SQLITE_ROW);
+        }
     }
 
     bool cache::has_liquid_blinding_nonce(byte_span_t pubkey, byte_span_t script)
     {
+        locker_t locker(m_mutex);
         GDK_RUNTIME_ASSERT(!pubkey.empty() && !script.empty());
-        if (!m_stmt_liquid_blinding_nonce_has) {
-            return false;
-        }
-        const auto _{ stmt_clean(m_stmt_liquid_blinding_nonce_has) };
-        bind_liquid_blinding(m_stmt_liquid_blinding_nonce_has, pubkey, script);
-        return has_result(m_stmt_liquid_blinding_nonce_has);
+        const bool found = m_liquid_blinding_nonces.find(liquid_blinding_nonce_key(pubkey, script)) != nullptr;
+        m_liquid_blinding_nonce_stats.on_lookup(found);
+        return found;
     }
 
     boost::optional<std::vector<unsigned char>> cache::get_liquid_blinding_nonce(byte_span_t pubkey, byte_span_t script)
     {
+        locker_t locker(m_mutex);
         GDK_RUNTIME_ASSERT(!pubkey.empty() && !script.empty());
-        GDK_RUNTIME_ASSERT(m_stmt_liquid_blinding_nonce_search.get());
-        const auto _{ stmt_clean(m_stmt_liquid_blinding_nonce_search) };
-        bind_liquid_blinding(m_stmt_liquid_blinding_nonce_search, pubkey, script);
-        return get_blob(m_stmt_liquid_blinding_nonce_search, 0);
+        GDK_RUNTIME_ASSERT(m_is_liquid);
+        const auto nonce = m_liquid_blinding_nonces.find(liquid_blinding_nonce_key(pubkey, script));
+        m_liquid_blinding_nonce_stats.on_lookup(nonce != nullptr);
+        if (!nonce) {
+            return boost::none;
+        }
+        return *nonce;
+    }
+
+    bool cache::has_liquid_unblind_failure(byte_span_t txhash, const uint32_t vout)
+    {
+        locker_t locker(m_mutex);
+        GDK_RUNTIME_ASSERT(!txhash.empty());
+        const bool found = m_liquid_unblind_failures.find(liquid_output_key(txhash, vout)) != nullptr;
+        m_liquid_unblind_failure_stats.on_lookup(found);
+        return found;
     }
 
     bool cache::has_liquid_output(byte_span_t txhash, const uint32_t vout)
     {
+        locker_t locker(m_mutex);
         GDK_RUNTIME_ASSERT(!txhash.empty());
-        if (!m_stmt_liquid_blinding_nonce_has) {
-            return false;
-        }
-        const auto _{ stmt_clean(m_stmt_liquid_output_has) };
-        bind_blob(m_stmt_liquid_output_has, 1, txhash);
-        GDK_RUNTIME_ASSERT(sqlite3_bind_int(m_stmt_liquid_output_has.get(), 2, vout) == SQLITE_OK);
-        return has_result(m_stmt_liquid_output_has);
+        const bool found = m_liquid_outputs.find(liquid_output_key(txhash, vout)) != nullptr;
+        m_liquid_output_stats.on_lookup(found);
+        return found;
     }
 
     boost::optional<nlohmann::json> cache::get_liquid_output(byte_span_t txhash, const uint32_t vout)
     {
+        locker_t locker(m_mutex);
         GDK_RUNTIME_ASSERT(!txhash.empty());
-        GDK_RUNTIME_ASSERT(m_stmt_liquid_output_search.get());
-        const auto _{ stmt_clean(m_stmt_liquid_output_search) };
-        bind_blob(m_stmt_liquid_output_search, 1, txhash);
-        GDK_RUNTIME_ASSERT(sqlite3_bind_int(m_stmt_liquid_output_search.get(), 2, vout) == SQLITE_OK);
-        const int rc = sqlite3_step(m_stmt_liquid_output_search.get());
-        if (rc == SQLITE_DONE) {
+        GDK_RUNTIME_ASSERT(m_is_liquid);
+        const auto value = m_liquid_outputs.find(liquid_output_key(txhash, vout));
+        m_liquid_output_stats.on_lookup(value != nullptr);
+        if (!value) {
             return boost::none;
         }
-        GDK_RUNTIME_ASSERT(rc == SQLITE_ROW);
+        // cache values are stored in byte order not display order (reversed)
         nlohmann::json utxo;
-        const auto _get_reversed_result = [this](const int column, const int size) {
-            GDK_RUNTIME_ASSERT(sqlite3_column_bytes(m_stmt_liquid_output_search.get(), column) == size);
-            const auto res = reinterpret_cast<const unsigned char*>(
-                sqlite3_column_blob(m_stmt_liquid_output_search.get(), column));
-            GDK_RUNTIME_ASSERT(res);
-            // cache values are stored in byte order not display order (reversed)
-            return b2h_rev(gsl::make_span(res, size));
-        };
-
-        utxo["asset_id"] = _get_reversed_result(0, ASSET_TAG_LEN);
-        utxo["satoshi"] = sqlite3_column_int64(m_stmt_liquid_output_search.get(), 1);
-        utxo["assetblinder"] = _get_reversed_result(2, 32);
-        utxo["amountblinder"] = _get_reversed_result(3, 32);
-
-        step_final(m_stmt_liquid_output_search);
+        utxo["asset_id"] = b2h_rev(value->asset_id);
+        utxo["satoshi"] = value->satoshi;
+        utxo["assetblinder"] = b2h_rev(value->abf);
+        utxo["amountblinder"] = b2h_rev(value->vbf);
         return utxo;
     }
 
     void cache::upsert_key_value(const std::string& key, byte_span_t value)
     {
-        GDK_RUNTIME_ASSERT(!key.empty() && !value.empty());
-        const auto _{ stmt_clean(m_stmt_key_value_upsert) };
-        const auto key_span = ustring_span(key);
-        bind_blob(m_stmt_key_value_upsert, 1, key_span);
-        bind_blob(m_stmt_key_value_upsert, 2, value);
-        step_final(m_stmt_key_value_upsert);
+        locker_t locker(m_mutex);
+        upsert_blob(m_stmt_key_value_upsert, key, value);
+        m_key_value_stats.on_insert(key.size() + value.size());
         m_require_write = true;
     }
 
     void cache::insert_liquid_blinding_nonce(byte_span_t pubkey, byte_span_t script, byte_span_t nonce)
+    {
+        locker_t locker(m_mutex);
+        if (insert_liquid_blinding_nonce_impl(pubkey, script, nonce)) {
+            m_require_write = true;
+        }
+    }
+
+    size_t cache::insert_liquid_blinding_nonces(gsl::span<const liquid_blinding_nonce_t> nonces)
+    {
+        locker_t locker(m_mutex);
+        size_t num_inserted = 0;
+        if (!nonces.empty()) {
+            try {
+                in_transaction(m_db, [&] {
+                    for (const auto& n : nonces) {
+                        num_inserted += insert_liquid_blinding_nonce_impl(n.pubkey, n.script, n.nonce);
+                    }
+                });
+            } catch (const std::exception&) {
+                load_liquid_maps(); // Discard rows that were rolled back
+                throw;
+            }
+        }
+        if (num_inserted) {
+            m_require_write = true;
+        }
+        return num_inserted;
+    }
+
+    size_t cache::insert_liquid_unblind_failures(gsl::span<const liquid_unblind_failure_t> failures)
+    {
+        locker_t locker(m_mutex);
+        if (!m_is_liquid || failures.empty()) {
+            return 0;
+        }
+        size_t num_inserted = 0;
+        try {
+            in_transaction(m_db, [&] {
+                for (const auto& f : failures) {
+                    GDK_RUNTIME_ASSERT(!f.txhash.empty() && !f.pubkey.empty() && !f.script.empty());
+                    const auto key = liquid_output_key(f.txhash, f.vout);
+                    if (m_liquid_unblind_failures.find(key)) {
+                        continue; // Already cached
+                    }
+                    const auto _{ stmt_clean(m_stmt_liquid_unblind_failure_insert) };
+                    bind_liquid_blinding(m_stmt_liquid_unblind_failure_insert, f.pubkey, f.script);
+                    bind_blob(m_stmt_liquid_unblind_failure_insert, 3, f.txhash);
+                    GDK_RUNTIME_ASSERT(
+                        sqlite3_bind_int(m_stmt_liquid_unblind_failure_insert.get(), 4, f.vout) == SQLITE_OK);
+                    step_final(m_stmt_liquid_unblind_failure_insert);
+                    m_liquid_unblind_failures.insert(key, true);
+                    m_liquid_unblind_failure_stats.on_insert(key.size() + f.pubkey.size() + f.script.size());
+                    ++num_inserted;
+                }
+            });
+        } catch (const std::exception&) {
+            load_liquid_maps(); // Discard rows that were rolled back
+            throw;
+        }
+        if (num_inserted) {
+            m_require_write = true;
+        }
+        return num_inserted;
+    }
+
+    void cache::clear_liquid_unblind_failures(byte_span_t pubkey, byte_span_t script)
+    {
+        if (m_liquid_unblind_failures.empty()) {
+            return;
+        }
+        size_t num_found = 0;
+        {
+            const auto _{ stmt_clean(m_stmt_liquid_unblind_failure_search) };
+            bind_liquid_blinding(m_stmt_liquid_unblind_failure_search, pubkey, script);
+            int rc;
+            while ((rc = sqlite3_step(m_stmt_liquid_unblind_failure_search.get())) == SQLITE_ROW) {
+                const uint32_t vout = sqlite3_column_int64(m_stmt_liquid_unblind_failure_search.get(), 1);
+                m_liquid_unblind_failures.erase(
+                    liquid_output_key(column_blob(m_stmt_liquid_unblind_failure_search, 0), vout));
+                ++num_found;
+            }
+            GDK_RUNTIME_ASSERT(rc == SQLITE_DONE);
+        }
+        if (num_found) {
+            // The outputs may be unblindable with the new nonce
+            const auto _{ stmt_clean(m_stmt_liquid_unblind_failure_delete) };
+            bind_liquid_blinding(m_stmt_liquid_unblind_failure_delete, pubkey, script);
+            step_final(m_stmt_liquid_unblind_failure_delete);
+        }
+    }
+
+    bool cache::set_liquid_unspent_outputs(uint32_t subaccount, gsl::span<const liquid_output_ref_t> unspent)
+    {
+        locker_t locker(m_mutex);
+        if (!m_is_liquid) {
+            return false;
+        }
+        std::set<std::vector<unsigned char>> current, keys;
+        {
+            const auto _{ stmt_clean(m_stmt_liquid_unspent_search) };
+            GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_liquid_unspent_search.get(), 1, subaccount) == SQLITE_OK);
+            int rc;
+            while ((rc = sqlite3_step(m_stmt_liquid_unspent_search.get())) == SQLITE_ROW) {
+                const uint32_t vout = sqlite3_column_int64(m_stmt_liquid_unspent_search.get(), 1);
+                current.insert(liquid_output_key(column_blob(m_stmt_liquid_unspent_search, 0), vout));
+            }
+            GDK_RUNTIME_ASSERT(rc == SQLITE_DONE);
+        }
+        for (const auto& o : unspent) {
+            keys.insert(liquid_output_key(o.txhash, o.vout));
+        }
+        if (keys == current) {
+            return false; // Unchanged, avoid rewriting the db
+        }
+        in_transaction(m_db, [&] {
+            {
+                const auto _{ stmt_clean(m_stmt_liquid_unspent_clear) };
+                GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_liquid_unspent_clear.get(), 1, subaccount) == SQLITE_OK);
+                step_final(m_stmt_liquid_unspent_clear);
+            }
+            for (const auto& o : unspent) {
+                const auto _{ stmt_clean(m_stmt_liquid_unspent_insert) };
+                GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_liquid_unspent_insert.get(), 1, subaccount) == SQLITE_OK);
+                bind_blob(m_stmt_liquid_unspent_insert, 2, o.txhash);
+                GDK_RUNTIME_ASSERT(sqlite3_bind_int(m_stmt_liquid_unspent_insert.get(), 3, o.vout) == SQLITE_OK);
+                if (!o.pubkey.empty() && !o.script.empty()) {
+                    bind_blob(m_stmt_liquid_unspent_insert, 4, o.pubkey);
+                    bind_blob(m_stmt_liquid_unspent_insert, 5, o.script);
+                }
+                step_final(m_stmt_liquid_unspent_insert);
+            }
+        });
+        m_require_write = true;
+        return true;
+    }
+
+    size_t cache::evict_spent_liquid_outputs(gsl::span<const liquid_output_ref_t> spent)
+    {
+        locker_t locker(m_mutex);
+        if (!m_is_liquid || spent.empty()) {
+            return 0;
+        }
+        size_t num_outputs = 0, num_nonces = 0, num_unspent = 0;
+        try {
+            in_transaction(m_db, [&] {
+                for (const auto& o : spent) {
+                    {
+                        const auto _{ stmt_clean(m_stmt_liquid_unspent_delete) };
+                        bind_blob(m_stmt_liquid_unspent_delete, 1, o.txhash);
+                        GDK_RUNTIME_ASSERT(
+                            sqlite3_bind_int(m_stmt_liquid_unspent_delete.get(), 2, o.vout) == SQLITE_OK);
+                        step_final(m_stmt_liquid_unspent_delete);
+                        num_unspent += sqlite3_changes(m_db.get());
+                    }
+                    const auto output_key = liquid_output_key(o.txhash, o.vout);
+                    if (m_liquid_outputs.find(output_key)) {
+                        const auto _{ stmt_clean(m_stmt_liquid_output_delete) };
+                        bind_blob(m_stmt_liquid_output_delete, 1, o.txhash);
+                        GDK_RUNTIME_ASSERT(
+                            sqlite3_bind_int(m_stmt_liquid_output_delete.get(), 2, o.vout) == SQLITE_OK);
+                        step_final(m_stmt_liquid_output_delete);
+                        m_liquid_outputs.erase(output_key);
+                        ++num_outputs;
+                    }
+                    if (o.pubkey.empty() || o.script.empty()) {
+                        continue;
+                    }
+                    const auto nonce_key = liquid_blinding_nonce_key(o.pubkey, o.script);
+                    if (m_liquid_blinding_nonces.find(nonce_key)) {
+                        const auto _{ stmt_clean(m_stmt_liquid_blinding_nonce_delete) };
+                        bind_liquid_blinding(m_stmt_liquid_blinding_nonce_delete, o.pubkey, o.script);
+                        step_final(m_stmt_liquid_blinding_nonce_delete);
+                        m_liquid_blinding_nonces.erase(nonce_key);
+                        ++num_nonces;
+                    }
+                }
+            });
+        } catch (const std::exception&) {
+            load_liquid_maps(); // Restore rows that were rolled back
+            throw;
+        }
+        if (num_outputs || num_nonces) {
+            m_evicted_outputs += num_outputs;
+            m_evicted_nonces += num_nonces;
+            m_require_write = true;
+            compact_db();
+        } else if (num_unspent) {
+            m_require_write = true;
+        }
+        return num_outputs;
+    }
+
+    bool cache::insert_liquid_blinding_nonce_impl(byte_span_t pubkey, byte_span_t script, byte_span_t nonce)
     {
         GDK_RUNTIME_ASSERT(!pubkey.empty() && !script.empty() && !nonce.empty());
         GDK_RUNTIME_ASSERT(m_stmt_liquid_blinding_nonce_insert.get());
+        auto key = liquid_blinding_nonce_key(pubkey, script);
+        if (m_liquid_blinding_nonces.find(key)) {
+            return false; // Already cached
+        }
         const auto _{ stmt_clean(m_stmt_liquid_blinding_nonce_insert) };
         bind_liquid_blinding(m_stmt_liquid_blinding_nonce_insert, pubkey, script);
         bind_blob(m_stmt_liquid_blinding_nonce_insert, 3, nonce);
         step_final(m_stmt_liquid_blinding_nonce_insert);
-        m_require_write = true;
+        m_liquid_blinding_nonces.insert(key, std::vector<unsigned char>(nonce.begin(), nonce.end()));
+        m_liquid_blinding_nonce_stats.on_insert(pubkey.size() + script.size() + nonce.size());
+        clear_liquid_unblind_failures(pubkey, script);
+        return true;
     }
 
     void cache::insert_liquid_output(byte_span_t txhash, uint32_t vout, nlohmann::json& utxo)
+    {
+        locker_t locker(m_mutex);
+        if (insert_liquid_output_impl(txhash, vout, utxo)) {
+            m_require_write = true;
+        }
+    }
+
+    size_t cache::insert_liquid_outputs(gsl::span<const liquid_output_t> outputs)
+    {
+        locker_t locker(m_mutex);
+        size_t num_inserted = 0;
+        if (!outputs.empty()) {
+            try {
+                in_transaction(m_db, [&] {
+                    for (const auto& o : outputs) {
+                        num_inserted += insert_liquid_output_impl(o.txhash, o.vout, o.utxo);
+                    }
+                });
+            } catch (const std::exception&) {
+                load_liquid_maps(); // Discard rows that were rolled back
+                throw;
+            }
+        }
+        if (num_inserted) {
+            m_require_write = true;
+        }
+        return num_inserted;
+    }
+
+    bool cache::insert_liquid_output_impl(byte_span_t txhash, uint32_t vout, const nlohmann::json& utxo)
     {
         GDK_RUNTIME_ASSERT(!txhash.empty() && !utxo.empty());
         GDK_RUNTIME_ASSERT(m_stmt_liquid_output_insert.get());
-        const auto _{ stmt_clean(m_stmt_liquid_output_insert) };
+        const auto key = liquid_output_key(txhash, vout);
+        if (m_liquid_outputs.find(key)) {
+            return false; // Already cached
+        }
 
         // cache values are stored in byte order not display order (reversed)
-        bind_blob(m_stmt_liquid_output_insert, 1, txhash);
+        liquid_output_value_t value;
+        value.asset_id = make_byte_array<ASSET_TAG_LEN>(h2b_rev(utxo.at("asset_id")));
+        value.satoshi = utxo.at("satoshi");
+        value.abf = make_byte_array<32>(h2b_rev(utxo.at("assetblinder")));
+        value.vbf = make_byte_array<32>(h2b_rev(utxo.at("amountblinder")));
 
+        const auto _{ stmt_clean(m_stmt_liquid_output_insert) };
+        bind_blob(m_stmt_liquid_output_insert, 1, txhash);
         GDK_RUNTIME_ASSERT(sqlite3_bind_int(m_stmt_liquid_output_insert.get(), 2, vout) == SQLITE_OK);
-        const auto assetid = h2b_rev(utxo["asset_id"]);
-        bind_blob(m_stmt_liquid_output_insert, 3, assetid);
+        bind_blob(m_stmt_liquid_output_insert, 3, value.asset_id);
+        GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_liquid_output_insert.get(), 4, value.satoshi) == SQLITE_OK);
+        bind_blob(m_stmt_liquid_output_insert, 5, value.abf);
+        bind_blob(m_stmt_liquid_output_insert, 6, value.vbf);
+        step_final(m_stmt_liquid_output_insert);
 
-        const auto satoshi = utxo.at("satoshi");
-        GDK_RUNTIME_ASSERT(sqlite3_bind_int64(m_stmt_liquid_output_insert.get(), 4, satoshi) == SQLITE_OK);
+        m_liquid_outputs.insert(key, value);
+        m_liquid_output_stats.on_insert(key.size() + sizeof(value));
+        return true;
+    }
 
-        const auto abf = h2b_rev(utxo["assetblinder"]);
-        bind_blob(m_stmt_liquid_output_insert, 5, abf);
-        const auto vbf = h2b_rev(utxo["amountblinder"]);
-        bind_blob(m_stmt_liquid_output_insert, 6, vbf);
+    void cache::load_liquid_maps()
+    {
+        m_liquid_outputs.clear();
+        m_liquid_blinding_nonces.clear();
+        m_liquid_unblind_failures.clear();
+        if (!m_is_liquid) {
+            return;
+        }
 
-        step_final(m_stmt_liquid_output_insert);
-        m_require_write = true;
+        auto stmt{ get_stmt(true, m_db, "SELECT txid, vout, assetid, satoshi, abf, vbf FROM LiquidOutput;") };
+        int rc;
+        while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+            liquid_output_value_t value;
+            value.asset_id = make_byte_array<ASSET_TAG_LEN>(column_blob(stmt, 2));
+            value.satoshi = sqlite3_column_int64(stmt.get(), 3);
+            value.abf = make_byte_array<32>(column_blob(stmt, 4));
+            value.vbf = make_byte_array<32>(column_blob(stmt, 5));
+            const uint32_t vout = sqlite3_column_int64(stmt.get(), 1);
+            m_liquid_outputs.insert(liquid_output_key(column_blob(stmt, 0), vout), value);
+        }
+        GDK_RUNTIME_ASSERT(rc == SQLITE_DONE);
+
+        stmt = get_stmt(true, m_db, "SELECT pubkey, script, nonce FROM LiquidBlindingNonce;");
+        while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+            const auto nonce = column_blob(stmt, 2);
+            m_liquid_blinding_nonces.insert(liquid_blinding_nonce_key(column_blob(stmt, 0), column_blob(stmt, 1)),
+                std::vector<unsigned char>(nonce.begin(), nonce.end()));
+        }
+        GDK_RUNTIME_ASSERT(rc == SQLITE_DONE);
+
+        stmt = get_stmt(true, m_db, "SELECT txid, vout FROM LiquidUnblindFailure;");
+        while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+            const uint32_t vout = sqlite3_column_int64(stmt.get(), 1);
+            m_liquid_unblind_failures.insert(liquid_output_key(column_blob(stmt, 0), vout), true);
+        }
+        GDK_RUNTIME_ASSERT(rc == SQLITE_DONE);
+        GDK_LOG_SEV(log_level::info) << "Loaded " << m_liquid_outputs.size() << " outputs, "
+                                     << m_liquid_blinding_nonces.size() << " nonces and "
+                                     << m_liquid_unblind_failures.size() << " unblind failures";
     }
 } // namespace sdk
 } // namespace ga
@@ -2,10 +2,16 @@
 #define GDK_GA_CACHE_HPP
 #pragma once
 
+#include "containers.hpp"
 #include "ga_wally.hpp"
 #include "gsl_wrapper.hpp"
+#include <array>
 #include <boost/optional.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <thread>
 
 struct sqlite3;
 struct sqlite3_stmt;
@@ -17,16 +23,89 @@ namespace sdk {
     struct cache final {
         using sqlite3_ptr = std::shared_ptr<struct ::sqlite3>;
         using sqlite3_stmt_ptr = std::shared_ptr<struct ::sqlite3_stmt>;
+        using page_hash_t = std::array<unsigned char, SHA256_LEN>;
+
+        // State of the on-disk page log, used to write only changed pages
+        struct page_log {
+            std::vector<page_hash_t> page_hashes; // Hashes of the pages last written
+            std::array<unsigned char, 16> id;
+            uint64_t sequence; // Sequence number of the next record
+            uint64_t size; // Size of the log file, or 0 if it must be rewritten
+        };
+
+        // Rows for the bulk insert APIs
+        struct liquid_output_t {
+            std::vector<unsigned char> txhash;
+            uint32_t vout;
+            nlohmann::json utxo;
+        };
+        struct liquid_blinding_nonce_t {
+            std::vector<unsigned char> pubkey;
+            std::vector<unsigned char> script;
+            std::vector<unsigned char> nonce;
+        };
+        // An output of the wallet. pubkey and script identify its blinding
+        // nonce, and may be empty if it has none.
+        struct liquid_output_ref_t {
+            std::vector<unsigned char> txhash;
+            uint32_t vout;
+            std::vector<unsigned char> pubkey;
+            std::vector<unsigned char> script;
+        };
+        // An output that could not be unblinded. pubkey and script identify
+        // the blinding nonce that would allow it to be unblinded.
+        struct liquid_unblind_failure_t {
+            std::vector<unsigned char> txhash;
+            uint32_t vout;
+            std::vector<unsigned char> pubkey;
+            std::vector<unsigned char> script;
+        };
+
+        // Identifies the script of a wallet address. The subtype (the number
+        // of CSV blocks for CSV scripts) is part of the key as it changes the script
+        struct address_key_t {
+            uint32_t subaccount;
+            uint32_t pointer;
+            uint32_t branch;
+            uint32_t script_type;
+            uint32_t subtype;
+        };
+
+        // The prevout script of a wallet address and the pubkeys derived for it
+        struct address_script_t {
+            std::vector<unsigned char> script;
+            pub_key_t ga_pub_key;
+            pub_key_t user_pub_key;
+        };
 
         cache(const network_parameters& net_params, const std::string& network_name);
+        ~cache();
 
         bool has_liquid_output(byte_span_t txhash, const uint32_t vout);
         boost::optional<nlohmann::json> get_liquid_output(byte_span_t txhash, const uint32_t vout);
         void insert_liquid_output(byte_span_t txhash, const uint32_t vout, nlohmann::json& utxo);
+        // Insert many outputs in a single transaction, returning the number of new rows
+        size_t insert_liquid_outputs(gsl::span<const liquid_output_t> outputs);
 
         bool has_liquid_blinding_nonce(byte_span_t pubkey, byte_span_t script);
         boost::optional<std::vector<unsigned char>> get_liquid_blinding_nonce(byte_span_t pubkey, byte_span_t script);
         void insert_liquid_blinding_nonce(byte_span_t pubkey, byte_span_t script, byte_span_t nonce);
+        // Insert many nonces in a single transaction, returning the number of new rows
+        size_t insert_liquid_blinding_nonces(gsl::span<const liquid_blinding_nonce_t> nonces);
+
+        // Outputs that failed to unblind are remembered so that they are not
+        // rewound again. Inserting a blinding nonce forgets the failures for it.
+        bool has_liquid_unblind_failure(byte_span_t txhash, const uint32_t vout);
+        // Insert many failures in a single transaction, returning the number of new rows
+        size_t insert_liquid_unblind_failures(gsl::span<const liquid_unblind_failure_t> failures);
+
+        // Record the unspent outputs of a subaccount, returning true if they
+        // changed. They and their nonces are kept when the oldest rows are
+        // evicted at load.
+        bool set_liquid_unspent_outputs(uint32_t subaccount, gsl::span<const liquid_output_ref_t> unspent);
+
+        // Remove spent outputs and their nonces, returning the number of outputs removed
+        size_t evict_spent_liquid_outputs(gsl::span<const liquid_output_ref_t> spent);
 
         typedef std::function<void(boost::optional<byte_span_t>)> get_key_value_fn;
         void get_key_value(const std::string& key, const get_key_value_fn& callback);
@@ -34,10 +113,84 @@ namespace sdk {
         void upsert_key_value(const std::string& key, byte_span_t value);
         void clear_key_value(const std::string& key);
 
+        // Persisted transaction lists, one msgpack encoded tx per ordinal
+        using tx_list_row_t = std::pair<int64_t, std::vector<unsigned char>>;
+        using get_tx_list_fn = std::function<void(int64_t, byte_span_t)>;
+        // Call 'callback' for each tx from newest to oldest, returning the oldest txhash if known
+        std::string get_tx_list(uint32_t subaccount, const get_tx_list_fn& callback);
+        // Remove txs outside [keep_min, keep_max] and write 'txs', in a single transaction
+        void update_tx_list(uint32_t subaccount, int64_t keep_min, int64_t keep_max,
+            gsl::span<const tx_list_row_t> txs, const std::string& oldest_txhash);
+        void clear_tx_lists();
+
+        boost::optional<address_script_t> get_address_script(const address_key_t& key);
+        void insert_address_script(const address_key_t& key, const address_script_t& value);
+
+        // Asset registry data, one msgpack encoded value per asset id for each registry type
+        using registry_entry_t = std::pair<std::string, std::vector<unsigned char>>;
+        using get_registry_fn = std::function<void(const std::string&, byte_span_t)>;
+        // Replace all entries of the given type in a single transaction
+        void replace_registry(const std::string& type, gsl::span<const registry_entry_t> entries);
+        // Call 'callback' for each of 'asset_ids' that is present, or for every entry if empty
+        void get_registry(
+            const std::string& type, gsl::span<const std::string> asset_ids, const get_registry_fn& callback);
+
+        // Save the database if it has changed. When a write delay is
+        // configured, this only schedules the write on the writer thread.
         void save_db();
+        // Complete any scheduled write
+        void flush();
         void load_db(byte_span_t encryption_key, const uint32_t type);
 
+        // Usage, write and eviction statistics
+        nlohmann::json get_stats();
+
     private:
+        using locker_t = std::unique_lock<std::mutex>;
+
+        struct table_stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t inserts = 0;
+            uint64_t bytes = 0; // Total size of inserted rows
+            void on_lookup(bool found) { ++(found ? hits : misses); }
+            void on_insert(size_t size)
+            {
+                ++inserts;
+                bytes += size;
+            }
+            nlohmann::json to_json() const;
+        };
+
+        // Counts of durations, in buckets increasing by powers of 4 from 1ms
+        struct latency_histogram {
+            static constexpr size_t NUM_BUCKETS = 8;
+            std::array<uint64_t, NUM_BUCKETS> counts{};
+            uint64_t total_us = 0;
+            uint64_t max_us = 0;
+            void add(std::chrono::microseconds latency);
+            nlohmann::json to_json() const;
+        };
+
+        void write_db(locker_t& locker);
+        void flush_impl(locker_t& locker);
+        void writer_thread_fn();
+        bool insert_liquid_output_impl(byte_span_t txhash, const uint32_t vout, const nlohmann::json& utxo);
+        bool insert_liquid_blinding_nonce_impl(byte_span_t pubkey, byte_span_t script, byte_span_t nonce);
+        void clear_liquid_unblind_failures(byte_span_t pubkey, byte_span_t script);
+        void load_liquid_maps();
+        size_t evict_oldest(const char* table, uint64_t max_rows, const char* unspent_match);
+        void compact_db();
+
+        // Unblinded output values, in byte order
+        struct liquid_output_value_t {
+            std::array<unsigned char, ASSET_TAG_LEN> asset_id;
+            uint64_t satoshi;
+            std::array<unsigned char, 32> abf;
+            std::array<unsigned char, 32> vbf;
+        };
+
+        std::mutex m_mutex;
         const std::string m_network_name;
         const bool m_is_liquid;
         uint32_t m_type; // Set on first call to load_db
@@ -45,16 +198,64 @@ namespace sdk {
         std::string m_db_name; // Set on first call to load_db
         std::array<unsigned char, SHA256_LEN> m_encryption_key; // Set on first call to load_db
         bool m_require_write;
+        page_log m_log;
+        std::chrono::milliseconds m_write_delay; // Set on first call to load_db
+        std::chrono::steady_clock::time_point m_write_requested;
+        bool m_write_pending;
+        bool m_writing;
+        bool m_flush_requested;
+        bool m_stop_writer;
+        uint64_t m_pending_writes; // save_db calls since the last write started
+        uint64_t m_total_writes;
+        uint64_t m_coalesced_writes;
+        std::chrono::microseconds m_last_write_latency;
+        latency_histogram m_write_latency;
+        latency_histogram m_load_latency;
+        table_stats m_liquid_output_stats;
+        table_stats m_liquid_blinding_nonce_stats;
+        table_stats m_liquid_unblind_failure_stats;
+        table_stats m_key_value_stats;
+        table_stats m_tx_list_stats;
+        table_stats m_registry_stats;
+        table_stats m_address_script_stats;
+        uint64_t m_max_liquid_rows; // Set on first call to load_db, 0 for no limit
+        uint64_t m_evicted_outputs;
+        uint64_t m_evicted_nonces;
+        uint64_t m_evicted_unblind_failures;
+        uint64_t m_vacuums;
+        uint64_t m_vacuumed_bytes; // Bytes removed from the database image by compaction
+        std::condition_variable m_write_cv;
+        std::thread m_writer;
+        // In-memory copies of the Liquid tables, so lookups never touch sqlite
+        open_hash_map<liquid_output_value_t> m_liquid_outputs;
+        open_hash_map<std::vector<unsigned char>> m_liquid_blinding_nonces;
+        open_hash_map<bool> m_liquid_unblind_failures;
         sqlite3_ptr m_db;
-        sqlite3_stmt_ptr m_stmt_liquid_blinding_nonce_has;
-        sqlite3_stmt_ptr m_stmt_liquid_blinding_nonce_search;
         sqlite3_stmt_ptr m_stmt_liquid_blinding_nonce_insert;
-        sqlite3_stmt_ptr m_stmt_liquid_output_has;
-        sqlite3_stmt_ptr m_stmt_liquid_output_search;
+        sqlite3_stmt_ptr m_stmt_liquid_blinding_nonce_delete;
         sqlite3_stmt_ptr m_stmt_liquid_output_insert;
+        sqlite3_stmt_ptr m_stmt_liquid_output_delete;
+        sqlite3_stmt_ptr m_stmt_liquid_unblind_failure_insert;
+        sqlite3_stmt_ptr m_stmt_liquid_unblind_failure_search;
+        sqlite3_stmt_ptr m_stmt_liquid_unblind_failure_delete;
+        sqlite3_stmt_ptr m_stmt_liquid_unspent_search;
+        sqlite3_stmt_ptr m_stmt_liquid_unspent_insert;
+        sqlite3_stmt_ptr m_stmt_liquid_unspent_clear;
+        sqlite3_stmt_ptr m_stmt_liquid_unspent_delete;
         sqlite3_stmt_ptr m_stmt_key_value_upsert;
         sqlite3_stmt_ptr m_stmt_key_value_search;
         sqlite3_stmt_ptr m_stmt_key_value_delete;
+        sqlite3_stmt_ptr m_stmt_tx_list_search;
+        sqlite3_stmt_ptr m_stmt_tx_list_upsert;
+        sqlite3_stmt_ptr m_stmt_tx_list_trim;
+        sqlite3_stmt_ptr m_stmt_tx_list_state_search;
+        sqlite3_stmt_ptr m_stmt_tx_list_state_upsert;
+        sqlite3_stmt_ptr m_stmt_registry_search;
+        sqlite3_stmt_ptr m_stmt_registry_search_all;
+        sqlite3_stmt_ptr m_stmt_registry_insert;
+        sqlite3_stmt_ptr m_stmt_registry_clear;
+        sqlite3_stmt_ptr m_stmt_address_script_search;
+        sqlite3_stmt_ptr m_stmt_address_script_insert;
     };
 
 } // namespace sdk
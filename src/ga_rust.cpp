@@ -241,6 +241,16 @@ namespace sdk {
         return call_session("get_transactions", actual_details);
     }
 
+    nlohmann::json ga_rust::get_transactions_cursor(const nlohmann::json& /*details*/)
+    {
+        throw std::runtime_error("get_transactions_cursor not yet implemented");
+    }
+
+    nlohmann::json ga_rust::cursor_next(const nlohmann::json& /*cursor*/)
+    {
+        throw std::runtime_error("cursor_next not yet implemented");
+    }
+
     void ga_rust::GDKRUST_notif_handler(void* self_context, GDKRUST_json* json)
     {
         // "new" needed because we want that to be on the heap. the notif handler will free it
@@ -501,6 +511,8 @@ namespace sdk {
 
     nlohmann::json ga_rust::get_fee_estimates() { return call_session("get_fee_estimates", nlohmann::json{}); }
 
+    nlohmann::json ga_rust::get_cache_stats() { throw std::runtime_error("get_cache_stats not yet implemented"); }
+
     std::string ga_rust::get_mnemonic_passphrase(const std::string& password)
     {
         if (!password.empty())
@@ -567,6 +579,11 @@ namespace sdk {
         throw std::runtime_error("set_blinding_nonce not yet implemented");
     }
 
+    bool ga_rust::set_blinding_nonces(const nlohmann::json& nonces)
+    {
+        throw std::runtime_error("set_blinding_nonces not yet implemented");
+    }
+
     bool ga_rust::has_blinding_nonce(const std::string& pubkey, const std::string& script)
     {
         throw std::runtime_error("hash_blinding_nonce not yet implemented");
@@ -93,6 +93,8 @@ namespace sdk {
 
         void change_settings_limits(const nlohmann::json& limit_details, const nlohmann::json& twofactor_data);
         nlohmann::json get_transactions(const nlohmann::json& details);
+        nlohmann::json get_transactions_cursor(const nlohmann::json& details);
+        nlohmann::json cursor_next(const nlohmann::json& cursor);
 
         void set_notification_handler(GA_notification_handler handler, void* context);
 
@@ -164,6 +166,7 @@ namespace sdk {
         void set_transaction_memo(const std::string& txhash_hex, const std::string& memo);
 
         nlohmann::json get_fee_estimates();
+        nlohmann::json get_cache_stats();
 
         std::string get_mnemonic_passphrase(const std::string& password);
 
@@ -175,6 +178,7 @@ namespace sdk {
         nlohmann::json convert_amount(const nlohmann::json& amount_json) const;
 
         void set_blinding_nonce(const std::string& pubkey, const std::string& script, const std::string& nonce);
+        bool set_blinding_nonces(const nlohmann::json& nonces);
         bool has_blinding_nonce(const std::string& pubkey, const std::string& script);
         nlohmann::json get_blinded_scripts(const nlohmann::json& details);
         void upload_confidential_addresses(uint32_t subaccount, const std::vector<std::string>& confidential_addresses);
@@ -147,10 +147,14 @@ namespace sdk {
         static const uint32_t DEFAULT_DISCONNECT_WAIT = 2; // maximum wait time on disconnect in seconds
         static const uint32_t DEFAULT_THREADPOOL_SIZE = 4; // Number of asio pool threads
 
-        static const std::string ZEROS(64, '0');
+        // Transaction cursors
+        static const uint32_t DEFAULT_CURSOR_COUNT = 30; // Default number of txs returned per call
+        static const uint32_t MAX_CURSOR_COUNT = 1000; // Maximum number of txs returned per call
+        static const uint32_t ALL_TXS = 0xffffffff; // Count to fetch the entire tx history
+        static const uint32_t MAX_FORMATTED_TXS = 1000; // Number of formatted txs kept for reuse
+        static const uint32_t MAX_PREWARMED_OUTPUTS = 1000; // Number of prewarmed outputs counted for hits
 
-        // Multi-call categories
-        constexpr uint32_t MC_TX_CACHE = 0x1; // Call affects the tx cache
+        static const std::string ZEROS(64, '0');
 
         // Transaction notification fields that we know about.
         // If we see a notification with fields other than these, we ignore
@@ -395,6 +399,69 @@ namespace sdk {
         {
             GDK_RUNTIME_ASSERT_MSG(memo.size() <= 1024, "Transaction memo too long");
         }
+
+        static cache::address_key_t get_address_key(const nlohmann::json& utxo)
+        {
+            return { json_get_value(utxo, "subaccount", 0u), utxo.at("pointer"), json_get_value(utxo, "branch", 1u),
+                utxo.at("script_type"), json_get_value(utxo, "subtype", 0u) };
+        }
+
+        // Store a registry response as one row per asset, keeping the
+        // remaining response data (e.g. headers) under the registry type
+        static void store_http_data(cache& c, const std::string& type, nlohmann::json data)
+        {
+            const auto& body = data.at("body");
+            std::vector<cache::registry_entry_t> entries;
+            entries.reserve(body.size());
+            for (const auto& item : body.items()) {
+                entries.emplace_back(item.key(), nlohmann::json::to_msgpack(item.value()));
+            }
+            c.replace_registry(type, entries);
+            data.erase("body");
+            c.upsert_key_value(type, nlohmann::json::to_msgpack(data));
+        }
+
+        // Get the number of a raw server tx's endpoints that have been spent.
+        // This changes when another tx spends from it after it was fetched.
+        static uint32_t get_spent_count(const nlohmann::json& tx_details)
+        {
+            const auto p = tx_details.find("eps");
+            if (p == tx_details.end()) {
+                return 0;
+            }
+            const auto& eps = *p;
+            const auto is_spent = [](const nlohmann::json& ep) { return json_get_value(ep, "is_spent", false); };
+            return static_cast<uint32_t>(std::count_if(eps.begin(), eps.end(), is_spent));
+        }
+
+        // Identify a Liquid utxo and its blinding nonce in the cache
+        static cache::liquid_output_ref_t get_liquid_output_ref(const nlohmann::json& utxo)
+        {
+            cache::liquid_output_ref_t output{ h2b(utxo.at("txhash")), utxo.at("pt_idx"), {}, {} };
+            const std::string nonce_commitment = json_get_value(utxo, "nonce_commitment");
+            const std::string script = json_get_value(utxo, "script");
+            if (!nonce_commitment.empty() && !script.empty()) {
+                output.pubkey = h2b(nonce_commitment);
+                output.script = h2b(script);
+            }
+            return output;
+        }
+
+        static std::vector<unsigned char> get_output_key(byte_span_t txhash, uint32_t vout)
+        {
+            std::vector<unsigned char> key(txhash.begin(), txhash.end());
+            for (size_t i = 0; i < sizeof(vout); ++i) {
+                key.push_back((vout >> (i * 8)) & 0xff);
+            }
+            return key;
+        }
+
+        // A tx is formatted differently for each subaccount it involves,
+        // since each sees only its own inputs and outputs as the wallet's
+        static std::vector<unsigned char> get_formatted_tx_key(uint32_t subaccount, byte_span_t txhash)
+        {
+            return get_output_key(txhash, subaccount);
+        }
     } // namespace
 
     uint32_t websocket_rng_type::operator()() const
@@ -448,7 +515,12 @@ namespace sdk {
         , m_watch_only(true)
         , m_is_locked(false)
         , m_tx_last_notification(std::chrono::system_clock::now())
-        , m_multi_call_category(0)
+        , m_tx_list_caches(m_net_params.is_liquid(), gdk_config().value("tx_cache_targeted_invalidation", true))
+        , m_formatted_txs(MAX_FORMATTED_TXS)
+        , m_tx_prefetch_pages(std::min(gdk_config().value("tx_prefetch_pages", 1u), tx_list_cache::MAX_PREFETCH_PAGES))
+        , m_prewarm_outputs(m_net_params.is_liquid() && gdk_config().value("prewarm_liquid_outputs", true))
+        , m_prewarmed_outputs(MAX_PREWARMED_OUTPUTS)
+        , m_prewarm_hits(0)
         , m_cache(m_net_params, net_params.at("name"))
         , m_user_agent(std::string(GDK_COMMIT) + " " + net_params.value("user_agent", ""))
         , m_electrum_url(
@@ -865,6 +937,14 @@ namespace sdk {
                     locker, new nlohmann::json({ { "event", "session" }, { "session", details } }));
             }
 
+            no_std_exception_escape([this, &locker] {
+                m_tx_list_caches.for_each([this, &locker](uint32_t subaccount, tx_list_cache& tx_list) {
+                    if (tx_list.is_loaded()) {
+                        persist_tx_list(locker, subaccount, tx_list);
+                    }
+                });
+            });
+            m_cache.flush(); // Write any pending cache changes before logging out
             m_signer.reset();
             m_local_encryption_key = boost::none;
             m_blob_aes_key = boost::none;
@@ -873,6 +953,11 @@ namespace sdk {
             m_blob.reset();
             m_blob_outdated = false;
             m_tx_list_caches.purge_all();
+            m_formatted_txs.clear();
+            m_prewarmed_outputs.clear();
+            m_prewarm_hits = 0;
+            m_prewarm_txhashes.clear(); // Drops any pending prewarm
+            m_prewarm_subaccounts.clear();
             // FIXME: securely destroy all held data
             // TODO: pass in whether we are disconnecting in order to reconnect,
             //       and if so, only securely destroy data not needed to re-login
@@ -943,13 +1028,14 @@ namespace sdk {
         return result;
     }
 
-    nlohmann::json ga_session::refresh_http_data(const std::string& type, bool refresh)
+    nlohmann::json ga_session::refresh_http_data(
+        const std::string& type, bool refresh, const std::vector<std::string>& asset_ids)
     {
-        nlohmann::json cached_data = nlohmann::json::object();
         std::string last_modified;
 
         {
             locker_t locker(m_mutex);
+            nlohmann::json cached_data = nlohmann::json::object();
             m_cache.get_key_value(type, { [&cached_data, &last_modified](const auto& db_blob) {
                 if (!db_blob) {
                     return;
@@ -962,32 +1048,40 @@ namespace sdk {
                     cached_data = nlohmann::json::object();
                 }
             } });
+            if (cached_data.contains("body")) {
+                // Written by an older version as a single value: split it into rows
+                store_http_data(m_cache, type, std::move(cached_data));
+                m_cache.save_db();
+            }
         }
 
-        if (!refresh) {
-            return cached_data;
-        }
-
-        const std::string url = m_net_params.get_registry_connection_string(m_use_tor) + "/" + type + ".json";
-        nlohmann::json get_params = { { "method", "GET" }, { "urls", { url } }, { "accept", "json" } };
-        if (!last_modified.empty()) {
-            get_params.update({ { "headers",
-                { { boost::beast::http::to_string(boost::beast::http::field::if_modified_since), last_modified } } } });
-        }
+        if (refresh) {
+            const std::string url = m_net_params.get_registry_connection_string(m_use_tor) + "/" + type + ".json";
+            nlohmann::json get_params = { { "method", "GET" }, { "urls", { url } }, { "accept", "json" } };
+            if (!last_modified.empty()) {
+                get_params.update({ { "headers",
+                    { { boost::beast::http::to_string(boost::beast::http::field::if_modified_since),
+                        last_modified } } } });
+            }
 
-        const nlohmann::json data = http_request(get_params);
+            nlohmann::json data = http_request(get_params);
 
-        GDK_RUNTIME_ASSERT_MSG(!data.contains("error"), "error during refresh");
-        if (data.value("not_modified", false)) {
-            // Our cached copy is up to date, return it
-            return cached_data;
+            GDK_RUNTIME_ASSERT_MSG(!data.contains("error"), "error during refresh");
+            // If not modified, our cached copy is up to date
+            if (!data.value("not_modified", false)) {
+                GDK_RUNTIME_ASSERT_MSG(data["body"].is_object(), "expected JSON");
+                locker_t locker(m_mutex);
+                store_http_data(m_cache, type, std::move(data));
+                m_cache.save_db();
+            }
         }
 
-        GDK_RUNTIME_ASSERT_MSG(data["body"].is_object(), "expected JSON");
+        nlohmann::json result = nlohmann::json::object();
         locker_t locker(m_mutex);
-        m_cache.upsert_key_value(type, nlohmann::json::to_msgpack(data));
-        m_cache.save_db();
-        return data;
+        m_cache.get_registry(type, asset_ids, [&result](const std::string& asset_id, byte_span_t value) {
+            result[asset_id] = nlohmann::json::from_msgpack(value.begin(), value.end());
+        });
+        return result;
     }
 
     nlohmann::json ga_session::refresh_assets(const nlohmann::json& params)
@@ -997,25 +1091,20 @@ namespace sdk {
         nlohmann::json result;
 
         const bool refresh = params.value("refresh", true);
+        // Only return the given assets, if any are given
+        const auto asset_ids = params.value("assets_id", std::vector<std::string>());
 
         if (params.value("assets", false)) {
-            const auto assets = refresh_http_data("index", refresh);
-            nlohmann::json json_assets;
-            if (assets.find("error") == assets.end()) {
-                json_assets = assets.value("body", nlohmann::json::object());
-                json_assets.update({ { m_net_params.policy_asset(),
-                    { { "asset_id", m_net_params.policy_asset() }, { "name", "btc" } } } });
+            auto json_assets = refresh_http_data("index", refresh, asset_ids);
+            const auto& policy_asset = m_net_params.policy_asset();
+            if (asset_ids.empty() || std::find(asset_ids.begin(), asset_ids.end(), policy_asset) != asset_ids.end()) {
+                json_assets[policy_asset] = { { "asset_id", policy_asset }, { "name", "btc" } };
             }
             result["assets"] = json_assets;
         }
 
         if (params.value("icons", false)) {
-            const auto icons = refresh_http_data("icons", refresh);
-            nlohmann::json json_icons;
-            if (icons.find("error") == icons.end()) {
-                json_icons = icons.value("body", nlohmann::json::object());
-            }
-            result["icons"] = json_icons;
+            result["icons"] = refresh_http_data("icons", refresh, asset_ids);
         }
 
         return result;
@@ -1439,38 +1528,9 @@ namespace sdk {
         return convert_amount(locker, details)["satoshi"] <= current_total;
     }
 
-    std::unique_ptr<ga_session::locker_t> ga_session::get_multi_call_locker(uint32_t category_flags, bool wait_for_lock)
-    {
-        std::unique_ptr<locker_t> locker{ new locker_t(m_mutex, std::defer_lock) };
-        for (;;) {
-            locker->lock();
-            if (!(m_multi_call_category & category_flags)) {
-                // No multi calls of this category are in progress.
-                // Exit the loop with the locker locked
-                break;
-            }
-            // Unlock and sleep to allow other threads to make progress
-            locker->unlock();
-            std::this_thread::sleep_for(1ms);
-            if (!wait_for_lock) {
-                // Exit the loop with the locker unlocked
-                break;
-            }
-            // Continue around loop to try again
-        }
-        return locker;
-    }
-
     void ga_session::on_new_transaction(const std::vector<uint32_t>& subaccounts, nlohmann::json details)
     {
-        auto locker_p{ get_multi_call_locker(MC_TX_CACHE, false) };
-        auto& locker = *locker_p;
-
-        if (!locker.owns_lock()) {
-            // Try again: 'post' this to allow the competing thread to proceed.
-            asio::post(m_pool, [this, subaccounts, details] { on_new_transaction(subaccounts, details); });
-            return;
-        }
+        locker_t locker(m_mutex);
 
         no_std_exception_escape([&]() {
             using namespace std::chrono_literals;
@@ -1516,6 +1576,19 @@ namespace sdk {
             }
             m_nlocktimes.reset();
 
+            const std::string txhash = json_get_value(details, "txhash");
+            if (m_prewarm_outputs && !m_watch_only && !txhash.empty()) {
+                // Unblind the new outputs before the caller asks for its balance.
+                // Txs notified before a pending prewarm starts are added to it,
+                // so bursts of notifications don't fill the thread pool
+                const bool is_pending = !m_prewarm_txhashes.empty();
+                m_prewarm_txhashes.insert(txhash);
+                m_prewarm_subaccounts.insert(subaccounts.begin(), subaccounts.end());
+                if (!is_pending) {
+                    asio::post(m_pool, [this] { prewarm_outputs(); });
+                }
+            }
+
             if (m_notification_handler == nullptr) {
                 return;
             }
@@ -1541,14 +1614,7 @@ namespace sdk {
 
     void ga_session::on_new_block(nlohmann::json details)
     {
-        auto locker_p{ get_multi_call_locker(MC_TX_CACHE, false) };
-        auto& locker = *locker_p;
-
-        if (!locker.owns_lock()) {
-            // Try again: 'post' this to allow the competing thread to proceed.
-            asio::post(m_pool, [this, details] { on_new_block(details); });
-            return;
-        }
+        locker_t locker(m_mutex);
 
         no_std_exception_escape([&]() {
             GDK_RUNTIME_ASSERT(locker.owns_lock());
@@ -2019,6 +2085,15 @@ namespace sdk {
         return { { "fees", m_fee_estimates } };
     }
 
+    nlohmann::json ga_session::get_cache_stats()
+    {
+        nlohmann::json stats = m_cache.get_stats();
+        locker_t locker(m_mutex);
+        stats["tx_list"] = m_tx_list_caches.get_stats();
+        stats["prewarm"] = { { "outputs", m_prewarmed_outputs.size() }, { "hits", m_prewarm_hits } };
+        return stats;
+    }
+
     std::string ga_session::get_mnemonic_passphrase(const std::string& password)
     {
         locker_t locker(m_mutex);
@@ -2415,93 +2490,154 @@ namespace sdk {
         update_fiat_rate(locker, fiat_rate.get_value_or(std::string()));
     }
 
-    bool ga_session::unblind_utxo(nlohmann::json& utxo, const std::string& policy_asset)
-    {
-        amount::value_type value;
-
-        if (boost::conversion::try_lexical_convert(json_get_value(utxo, "value"), value)) {
-            utxo["satoshi"] = value;
-            utxo["assetblinder"] = ZEROS;
-            utxo["amountblinder"] = ZEROS;
-            const auto asset_tag = h2b(utxo.value("asset_tag", policy_asset));
-            GDK_RUNTIME_ASSERT(asset_tag[0] == 0x1);
-            utxo["asset_id"] = b2h_rev(gsl::make_span(asset_tag.data() + 1, asset_tag.size() - 1));
-            utxo["confidential"] = false;
-            return false; // Cache not updated
-        }
-        if (utxo.contains("txhash")) {
-            const auto txhash = h2b(utxo.at("txhash"));
-            const auto vout = utxo["pt_idx"];
-            locker_t locker(m_mutex);
-            const auto value = m_cache.get_liquid_output(txhash, vout);
-            if (value) {
-                utxo.insert(value->begin(), value->end());
-                utxo["confidential"] = true;
-                return false; // Cache not updated
+    void ga_session::unblind_utxos(const std::vector<nlohmann::json*>& utxos, const std::string& policy_asset,
+        std::vector<cache::liquid_output_t>& unblinded)
+    {
+        std::vector<nlohmann::json*> confidential;
+        for (auto* utxo_p : utxos) {
+            auto& utxo = *utxo_p;
+            amount::value_type value;
+            if (boost::conversion::try_lexical_convert(json_get_value(utxo, "value"), value)) {
+                utxo["satoshi"] = value;
+                utxo["assetblinder"] = ZEROS;
+                utxo["amountblinder"] = ZEROS;
+                const auto asset_tag = h2b(utxo.value("asset_tag", policy_asset));
+                GDK_RUNTIME_ASSERT(asset_tag[0] == 0x1);
+                utxo["asset_id"] = b2h_rev(gsl::make_span(asset_tag.data() + 1, asset_tag.size() - 1));
+                utxo["confidential"] = false;
+            } else {
+                confidential.push_back(utxo_p);
             }
         }
-        const auto rangeproof = h2b(utxo.at("range_proof"));
-        const auto commitment = h2b(utxo.at("commitment"));
-        const auto nonce_commitment = h2b(utxo.at("nonce_commitment"));
-        const auto asset_tag = h2b(utxo.at("asset_tag"));
-        const auto extra_commitment = h2b(utxo.at("script"));
-
-        GDK_RUNTIME_ASSERT(asset_tag[0] == 0xa || asset_tag[0] == 0xb);
+        if (confidential.empty()) {
+            return;
+        }
 
-        const auto blinding_key = [this, &extra_commitment]() -> boost::optional<std::array<unsigned char, 32>> {
+        // Probe the cache for every output, and fetch the blinding nonces
+        // needed by hardware wallets, in a single critical section. The
+        // signer is kept so that software wallets can derive blinding keys
+        // without the session lock.
+        std::shared_ptr<signer> signer_p;
+        std::vector<boost::optional<nlohmann::json>> cached(confidential.size());
+        std::vector<boost::optional<std::vector<unsigned char>>> nonces(confidential.size());
+        std::vector<char> is_failed(confidential.size());
+        {
             locker_t locker(m_mutex);
             GDK_RUNTIME_ASSERT(m_signer != nullptr);
-
-            if (m_signer->is_hw_device()) {
-                return boost::none;
+            signer_p = m_signer;
+            const bool is_hw_device = signer_p->is_hw_device();
+            for (size_t i = 0; i < confidential.size(); ++i) {
+                const auto& utxo = *confidential[i];
+                if (utxo.contains("txhash")) {
+                    const auto txhash = h2b(utxo.at("txhash"));
+                    cached[i] = m_cache.get_liquid_output(txhash, utxo.at("pt_idx"));
+                    if (cached[i] && !m_prewarmed_outputs.empty()
+                        && m_prewarmed_outputs.find(get_output_key(txhash, utxo.at("pt_idx")))) {
+                        ++m_prewarm_hits;
+                    }
+                    // Spam and dust outputs we can't unblind are not rewound again
+                    is_failed[i] = !cached[i] && m_cache.has_liquid_unblind_failure(txhash, utxo.at("pt_idx"));
+                }
+                if (!cached[i] && !is_failed[i] && is_hw_device) {
+                    const auto nonce_commitment = h2b(utxo.at("nonce_commitment"));
+                    nonces[i] = m_cache.get_liquid_blinding_nonce(nonce_commitment, h2b(utxo.at("script")));
+                }
             }
+        }
 
-            // if it's software signer, fetch the blinding key immediately
-            return m_signer->get_blinding_key_from_script(extra_commitment);
-        }();
-
-        try {
-            unblind_t unblinded;
-            if (blinding_key) {
-                unblinded = asset_unblind(
-                    *blinding_key, rangeproof, commitment, nonce_commitment, extra_commitment, asset_tag);
-            } else if (has_blinding_nonce(utxo.at("nonce_commitment"), utxo.at("script"))) {
-                const auto blinding_nonce = get_blinding_nonce(utxo.at("nonce_commitment"), utxo.at("script"));
-                unblinded
-                    = asset_unblind_with_nonce(blinding_nonce, rangeproof, commitment, extra_commitment, asset_tag);
-            } else {
-                // hw and missing nonce in the map
-                utxo["error"] = "missing blinding nonce";
-                return false; // Cache not updated
+        // Rewinding rangeproofs dominates the cost of processing confidential
+        // outputs, so unblind the cache misses in parallel without any locks
+        std::vector<char> is_new(confidential.size());
+        std::vector<char> is_new_failure(confidential.size());
+        const auto post = [this](std::function<void()> task) { asio::post(m_pool, std::move(task)); };
+        parallel_for(confidential.size(), DEFAULT_THREADPOOL_SIZE, post, [&](size_t i) {
+            auto& utxo = *confidential[i];
+            if (cached[i]) {
+                utxo.insert(cached[i]->begin(), cached[i]->end());
+                utxo["confidential"] = true;
+                return; // Already cached
+            }
+            if (is_failed[i]) {
+                utxo["error"] = "failed to unblind utxo";
+                return; // Previously failed
             }
+            const auto rangeproof = h2b(utxo.at("range_proof"));
+            const auto commitment = h2b(utxo.at("commitment"));
+            const auto nonce_commitment = h2b(utxo.at("nonce_commitment"));
+            const auto asset_tag = h2b(utxo.at("asset_tag"));
+            const auto extra_commitment = h2b(utxo.at("script"));
+
+            GDK_RUNTIME_ASSERT(asset_tag[0] == 0xa || asset_tag[0] == 0xb);
+
+            try {
+                unblind_t unblinded;
+                if (!signer_p->is_hw_device()) {
+                    const auto blinding_key = signer_p->get_blinding_key_from_script(extra_commitment);
+                    unblinded = asset_unblind(
+                        blinding_key, rangeproof, commitment, nonce_commitment, extra_commitment, asset_tag);
+                } else if (nonces[i]) {
+                    unblinded
+                        = asset_unblind_with_nonce(*nonces[i], rangeproof, commitment, extra_commitment, asset_tag);
+                } else {
+                    // hw and missing nonce in the map
+                    utxo["error"] = "missing blinding nonce";
+                    return; // Nothing to cache
+                }
 
-            utxo["satoshi"] = std::get<3>(unblinded);
-            // Return in display order
-            utxo["assetblinder"] = b2h_rev(std::get<2>(unblinded));
-            utxo["amountblinder"] = b2h_rev(std::get<1>(unblinded));
-            utxo["asset_id"] = b2h_rev(std::get<0>(unblinded));
-            utxo["confidential"] = true;
-            if (utxo.contains("txhash")) {
-                const auto txhash = h2b(utxo.at("txhash"));
-                const auto vout = utxo["pt_idx"];
+                utxo["satoshi"] = std::get<3>(unblinded);
+                // Return in display order
+                utxo["assetblinder"] = b2h_rev(std::get<2>(unblinded));
+                utxo["amountblinder"] = b2h_rev(std::get<1>(unblinded));
+                utxo["asset_id"] = b2h_rev(std::get<0>(unblinded));
+                utxo["confidential"] = true;
+                is_new[i] = utxo.contains("txhash");
+            } catch (const std::exception& ex) {
+                utxo["error"] = "failed to unblind utxo";
+                is_new_failure[i] = utxo.contains("txhash");
+            }
+        });
 
-                locker_t locker(m_mutex);
-                // check again, we released the lock earlier, so some other thread could have started to unblind too
-                if (!m_cache.get_liquid_output(txhash, vout)) {
-                    m_cache.insert_liquid_output(txhash, vout, utxo);
-                    return true; // Cache was updated
-                }
+        // Return the newly unblinded outputs for the caller to insert
+        // into the cache in one batch
+        std::vector<cache::liquid_unblind_failure_t> failures;
+        for (size_t i = 0; i < confidential.size(); ++i) {
+            const auto& utxo = *confidential[i];
+            if (is_new[i]) {
+                unblinded.push_back({ h2b(utxo.at("txhash")), utxo.at("pt_idx"), utxo });
+            } else if (is_new_failure[i]) {
+                failures.push_back({ h2b(utxo.at("txhash")), utxo.at("pt_idx"), h2b(utxo.at("nonce_commitment")),
+                    h2b(utxo.at("script")) });
+            }
+        }
+        if (!failures.empty()) {
+            // Failures are rare, so record them immediately rather than
+            // returning them to the caller
+            locker_t locker(m_mutex);
+            if (m_cache.insert_liquid_unblind_failures(failures)) {
+                m_cache.save_db();
             }
-        } catch (const std::exception& ex) {
-            utxo["error"] = "failed to unblind utxo";
         }
-        return false; // Cache not updated
     }
 
     nlohmann::json ga_session::cleanup_utxos(nlohmann::json& utxos, const std::string& policy_asset)
     {
-        bool updated_cache = false;
+        std::vector<cache::liquid_output_t> unblinded;
+        cleanup_utxos(utxos, policy_asset, unblinded);
+
+        if (!unblinded.empty()) {
+            // Insert all newly unblinded outputs in a single transaction
+            locker_t locker(m_mutex);
+            if (m_cache.insert_liquid_outputs(unblinded)) {
+                m_cache.save_db();
+            }
+        }
+        return utxos;
+    }
 
+    void ga_session::cleanup_utxos(
+        nlohmann::json& utxos, const std::string& policy_asset, std::vector<cache::liquid_output_t>& unblinded)
+    {
+        std::vector<nlohmann::json*> to_unblind;
         for (auto& utxo : utxos) {
             // Clean up the type of returned values
             const bool external = !json_get_value(utxo, "private_key").empty();
@@ -2540,7 +2676,7 @@ namespace sdk {
                 // TODO: check data returned by server for blinded utxos
                 if (!policy_asset.empty()) {
                     if (json_get_value(utxo, "is_relevant", true)) {
-                        updated_cache |= unblind_utxo(utxo, policy_asset);
+                        to_unblind.push_back(&utxo);
                     }
                 } else {
                     amount::value_type value;
@@ -2548,28 +2684,25 @@ namespace sdk {
                     utxo["satoshi"] = value;
                 }
             }
+        }
+
+        unblind_utxos(to_unblind, policy_asset, unblinded);
+
+        for (auto& utxo : utxos) {
             utxo.erase("value");
             if (utxo.find("block_height") != utxo.end() && utxo["block_height"].is_null()) {
                 utxo["block_height"] = 0;
             }
             json_add_if_missing(utxo, "subtype", 0u);
         }
-
-        if (updated_cache) {
-            locker_t locker(m_mutex);
-            m_cache.save_db();
-        }
-        return utxos;
     }
 
-    tx_list_cache::container_type ga_session::get_tx_list(ga_session::locker_t& locker, uint32_t subaccount,
-        uint32_t page_id, const std::string& start_date, const std::string& end_date, nlohmann::json& state_info)
+    tx_list_cache::container_type ga_session::get_tx_list(uint32_t subaccount, uint32_t page_id,
+        const std::string& start_date, const std::string& end_date, nlohmann::json& state_info)
     {
-        GDK_RUNTIME_ASSERT(locker.owns_lock());
         const std::vector<std::string> date_range{ start_date, end_date };
 
-        auto result
-            = wamp_call(locker, "txs.get_list_v2", page_id, std::string(), std::string(), date_range, subaccount);
+        auto result = wamp_call("txs.get_list_v2", page_id, std::string(), std::string(), date_range, subaccount);
         nlohmann::json txs = wamp_cast_json(result);
 
         // Update block height and fiat rate in our state info
@@ -2587,28 +2720,116 @@ namespace sdk {
             std::make_move_iterator(tx_list.end()) };
     }
 
-    tx_list_cache::container_type ga_session::get_raw_transactions(uint32_t subaccount, uint32_t first, uint32_t count)
+    void ga_session::load_tx_list(ga_session::locker_t& locker, uint32_t subaccount, tx_list_cache& tx_list)
+    {
+        GDK_RUNTIME_ASSERT(locker.owns_lock());
+        tx_list_cache::container_type txs;
+        int64_t back_ordinal = 0;
+        std::string oldest_txhash;
+        try {
+            oldest_txhash = m_cache.get_tx_list(subaccount, [&txs, &back_ordinal](int64_t ordinal, byte_span_t tx) {
+                // Persisted txs must have consecutive ordinals
+                GDK_RUNTIME_ASSERT(txs.empty() || ordinal == back_ordinal - 1);
+                back_ordinal = ordinal;
+                txs.emplace_back(nlohmann::json::from_msgpack(tx.begin(), tx.end()));
+            });
+        } catch (const std::exception& e) {
+            // Start from scratch. Any persisted txs are replaced when we next persist
+            GDK_LOG_SEV(log_level::warning) << "Ignoring persisted tx list: " << e.what();
+            txs.clear();
+            back_ordinal = 0;
+        }
+        // Discard txs from the last REORG_BLOCKS blocks in case we missed a reorg
+        const uint32_t block_height = m_block_height > tx_list_cache::REORG_BLOCKS
+            ? m_block_height - tx_list_cache::REORG_BLOCKS + 1
+            : 0;
+        tx_list.load(std::move(txs), back_ordinal, oldest_txhash, block_height);
+    }
+
+    void ga_session::persist_tx_list(ga_session::locker_t& locker, uint32_t subaccount, tx_list_cache& tx_list)
+    {
+        GDK_RUNTIME_ASSERT(locker.owns_lock());
+        tx_list_changes changes;
+        if (tx_list.get_changes(changes)) {
+            m_cache.update_tx_list(subaccount, changes.keep_min, changes.keep_max, changes.txs, changes.oldest_txhash);
+            m_cache.save_db();
+        }
+    }
+
+    tx_list_cache::container_type ga_session::get_raw_transactions(
+        uint32_t subaccount, uint32_t first, uint32_t count, tx_list_cache::tx_cursor* cursor)
     {
         if (!count) {
             return tx_list_cache::container_type();
         }
 
-        auto locker_p{ get_multi_call_locker(MC_TX_CACHE, true) };
-        auto& locker = *locker_p;
+        std::shared_ptr<tx_list_cache> cache;
+        {
+            locker_t locker(m_mutex);
+            cache = m_tx_list_caches.get(subaccount);
+        }
 
-        // Mark for other threads that a tx cache affecting call is running
-        m_multi_call_category |= MC_TX_CACHE;
-        const auto cleanup = gsl::finally([this]() { m_multi_call_category &= ~MC_TX_CACHE; });
+        // Only calls for the same subaccount wait for each other. The session
+        // mutex is not held while fetching, so notifications and calls for
+        // other subaccounts can proceed in the meantime.
+        std::unique_lock<std::mutex> cache_locker(cache->get_mutex());
+        int64_t earliest_time;
+        {
+            locker_t locker(m_mutex);
+            m_tx_list_caches.apply_pending(subaccount, *cache);
+            if (!cache->is_loaded()) {
+                load_tx_list(locker, subaccount, *cache);
+            }
+            earliest_time = static_cast<int64_t>(m_earliest_block_time);
+        }
 
-        auto&& server_get = [this, &locker, subaccount](uint32_t page_id, const std::string& start_date,
+        auto&& server_get = [this, subaccount](uint32_t page_id, const std::string& start_date,
                                 const std::string& end_date, nlohmann::json& state_info) {
-            return get_tx_list(locker, subaccount, page_id, start_date, end_date, state_info);
+            return get_tx_list(subaccount, page_id, start_date, end_date, state_info);
         };
 
         tx_list_cache::container_type tx_list;
         nlohmann::json state_info;
-        std::tie(tx_list, state_info) = m_tx_list_caches.get(subaccount)->get(first, count, server_get);
+        nlohmann::json fetch_state_info = { { "cur_block", 0u }, { "fiat_exchange", nullptr } };
+        if (cursor) {
+            // Start from the position of the cursor, which is unaffected by new txs
+            first = cache->get_cursor_position(*cursor, fetch_state_info, server_get);
+        } else if (count == ALL_TXS) {
+            // Fetch the entire history with concurrent requests, rather than page by page
+            const auto post = [this](std::function<void()> task) { asio::post(m_pool, std::move(task)); };
+            cache->sync_all(earliest_time, fetch_state_info, server_get, DEFAULT_THREADPOOL_SIZE, post);
+        }
+        std::tie(tx_list, state_info) = cache->get(first, count, server_get);
+        if (cursor && !tx_list.empty()) {
+            *cursor = tx_list_cache::get_cursor(tx_list.back());
+        }
 
+        locker_t locker(m_mutex);
+        m_tx_list_caches.apply_pending(subaccount, *cache);
+        if (m_tx_list_caches.is_current(subaccount, cache)) {
+            persist_tx_list(locker, subaccount, *cache);
+        }
+        // Release the cache while the session is locked, so that no
+        // notifications are queued for it after applying them above
+        cache_locker.unlock();
+        update_tx_list_state(locker, fetch_state_info);
+        update_tx_list_state(locker, state_info);
+
+        // Fetch the next page in the background, so that the caller
+        // scrolling through their txs is served from memory
+        const uint64_t prefetch_size = static_cast<uint64_t>(first) + count * 2ull;
+        if (m_tx_prefetch_pages && prefetch_size <= std::numeric_limits<uint32_t>::max()) {
+            const uint32_t required_cache_size = static_cast<uint32_t>(prefetch_size);
+            const uint64_t generation = m_tx_list_caches.get_generation();
+            asio::post(m_pool, [this, subaccount, required_cache_size, generation] {
+                prefetch_transactions(subaccount, required_cache_size, m_tx_prefetch_pages, generation);
+            });
+        }
+        return tx_list;
+    }
+
+    void ga_session::update_tx_list_state(ga_session::locker_t& locker, const nlohmann::json& state_info)
+    {
         // Update our local block height from the returned results
         // TODO: Use block_hash/height reversal to detect reorgs & uncache
 
@@ -2620,206 +2841,410 @@ namespace sdk {
             const double fiat_rate = state_info["fiat_exchange"];
             update_fiat_rate(locker, std::to_string(fiat_rate));
         }
-
-        return tx_list;
     }
 
-    nlohmann::json ga_session::get_transactions(const nlohmann::json& details)
+    void ga_session::prefetch_transactions(
+        uint32_t subaccount, uint32_t required_cache_size, uint32_t num_pages, uint64_t generation)
     {
-        const uint32_t subaccount = details.at("subaccount");
-        const uint32_t first = details.at("first");
-        const uint32_t count = details.at("count");
+        bool more_required = false;
+        no_std_exception_escape([&] {
+            std::shared_ptr<tx_list_cache> cache;
+            {
+                locker_t locker(m_mutex);
+                if (m_tx_list_caches.get_generation() != generation) {
+                    // A new tx/block or a purge has invalidated our cached txs
+                    GDK_LOG_SEV(log_level::debug) << "tx prefetch cancelled for subaccount " << subaccount;
+                    return;
+                }
+                cache = m_tx_list_caches.get(subaccount);
+            }
+
+            std::unique_lock<std::mutex> cache_locker(cache->get_mutex(), std::try_to_lock);
+            if (!cache_locker.owns_lock() || !cache->is_loaded()) {
+                // The cache is in use, and its user will start a new prefetch
+                return;
+            }
+
+            auto&& server_get = [this, subaccount](uint32_t page_id, const std::string& start_date,
+                                    const std::string& end_date, nlohmann::json& state_info) {
+                return get_tx_list(subaccount, page_id, start_date, end_date, state_info);
+            };
+
+            nlohmann::json state_info = { { "cur_block", 0u }, { "fiat_exchange", nullptr } };
+            {
+                locker_t locker(m_mutex);
+                m_tx_list_caches.apply_pending(subaccount, *cache);
+            }
+            more_required = cache->prefetch(required_cache_size, state_info, server_get);
 
-        if (json_get_value(details, "clear_cache", false)) {
-            // Clear the tx list cache on user request
             locker_t locker(m_mutex);
-            m_tx_list_caches.purge_all();
+            m_tx_list_caches.apply_pending(subaccount, *cache);
+            if (m_tx_list_caches.is_current(subaccount, cache)) {
+                persist_tx_list(locker, subaccount, *cache);
+            }
+            cache_locker.unlock();
+            update_tx_list_state(locker, state_info);
+        });
+
+        if (more_required && num_pages > 1) {
+            // Fetch the next page as a separate task, giving notifications
+            // that would cancel the prefetch a chance to run in between
+            asio::post(m_pool, [this, subaccount, required_cache_size, num_pages, generation] {
+                prefetch_transactions(subaccount, required_cache_size, num_pages - 1, generation);
+            });
         }
+    }
 
-        tx_list_cache::container_type tx_list = get_raw_transactions(subaccount, first, count);
-        {
-            // Set tx memos in the returned txs from the blob cache
-            locker_t locker(m_mutex);
-            if (m_blob_outdated) {
-                load_client_blob(locker, true);
+    void ga_session::prewarm_outputs()
+    {
+        no_std_exception_escape([&] {
+            std::set<std::string> txhashes;
+            std::set<uint32_t> subaccounts;
+            {
+                // Take the pending txs, so that later notifications post a new prewarm
+                locker_t locker(m_mutex);
+                txhashes.swap(m_prewarm_txhashes);
+                subaccounts.swap(m_prewarm_subaccounts);
             }
-            for (auto& tx_details : tx_list) {
-                // Get the tx memo. Use the server provided value if
-                // its present (i.e. no client blob enabled yet, or watch-only)
-                const std::string svr_memo = json_get_value(tx_details, "memo");
-                const std::string blob_memo = m_blob.get_tx_memo(tx_details["txhash"]);
-                tx_details["memo"] = svr_memo.empty() ? blob_memo : svr_memo;
+            if (txhashes.empty()) {
+                return; // Dropped on logout
             }
-        }
 
-        const auto datadir = gdk_config().value("datadir", std::string{});
-        const auto path = datadir + "/state";
-        const bool is_liquid = m_net_params.is_liquid();
-        auto is_cached = true;
-        for (auto& tx_details : tx_list) {
-            const uint32_t tx_block_height = json_add_if_missing(tx_details, "block_height", 0, true);
-            // TODO: Server should set subaccount to null if this is a spend from multiple subaccounts
-            json_add_if_missing(tx_details, "has_payment_request", false);
-            const std::string fee_str = tx_details["fee"];
-            const amount::value_type fee = strtoull(fee_str.c_str(), nullptr, 10);
-            tx_details["fee"] = fee;
-            const std::string tx_data = json_get_value(tx_details, "data");
-            tx_details.erase("data");
-            const uint32_t tx_size = tx_details["size"];
-            tx_details.erase("size");
-            if (!tx_data.empty()) {
-                // Only unconfirmed transactions are returned with the tx hex.
-                // In this case update the size, weight etc.
-                // At the moment to fetch the correct info for confirmed
-                // transactions, callers must call get_transaction_details
-                // on the hash of the confirmed transaction.
-                // Once caching is implemented this info can be populated up
-                // front so callers can always expect it.
-                const auto tx = tx_from_hex(tx_data, tx_flags(is_liquid));
-
-                update_tx_info(m_net_params, tx, tx_details);
-            } else {
-                tx_details["transaction_size"] = tx_size;
-                tx_details["transaction_weight"] = tx_details["vsize"].get<uint32_t>() * 4;
-                json_rename_key(tx_details, "vsize", "transaction_vsize");
-            }
-            // Compute fee in satoshi/kb, with the best integer accuracy we can
-            const uint32_t tx_vsize = tx_details["transaction_vsize"];
-            tx_details["fee_rate"] = fee * 1000 / tx_vsize;
-
-            std::map<std::string, amount> received, spent;
-            std::map<uint32_t, nlohmann::json> in_map, out_map;
-            std::set<std::string> unique_asset_ids;
-
-            // Clean up and categorize the endpoints
-            cleanup_utxos(tx_details["eps"], m_net_params.policy_asset());
-
-            for (auto& ep : tx_details["eps"]) {
-                ep.erase("id");
-                json_add_if_missing(ep, "subaccount", 0, true);
-                json_rename_key(ep, "pubkey_pointer", "pointer");
-                json_rename_key(ep, "ad", "address");
-                json_add_if_missing(ep, "pointer", 0, true);
-                json_add_if_missing(ep, "address", std::string(), true);
-                ep.erase("is_credit");
-
-                const bool is_tx_output = json_get_value(ep, "is_output", false);
-                const bool is_relevant = json_get_value(ep, "is_relevant", false);
-
-                if (is_relevant && ep.find("error") == ep.end()) {
-                    const auto asset_id = asset_id_from_json(m_net_params, ep);
-                    unique_asset_ids.emplace(asset_id);
-
-                    // Compute the effect of the input/output on the wallets balance
-                    // TODO: Figure out what redeemable value for social payments is about
-                    const amount::value_type satoshi = ep.at("satoshi");
-
-                    auto& which_balance = is_tx_output ? received[asset_id] : spent[asset_id];
-                    which_balance += satoshi;
+            // Fetch the notified txs through the tx list cache, where they are among
+            // the newest txs. The caller's next tx list request is then served
+            // from the cache rather than repeating the fetch.
+            std::vector<nlohmann::json> outputs;
+            for (const auto subaccount : subaccounts) {
+                for (auto& tx : get_raw_transactions(subaccount, 0, DEFAULT_CURSOR_COUNT)) {
+                    if (!txhashes.count(json_get_value(tx, "txhash"))) {
+                        continue;
+                    }
+                    add_tx_output_txhashes(tx);
+                    for (auto& ep : tx.at("eps")) {
+                        if (json_get_value(ep, "is_output", false) && json_get_value(ep, "is_relevant", false)) {
+                            outputs.emplace_back(std::move(ep));
+                        }
+                    }
                 }
+            }
 
-                ep["addressee"] = std::string(); // default here, set below where needed
+            std::vector<nlohmann::json*> to_unblind;
+            {
+                locker_t locker(m_mutex);
+                for (auto& output : outputs) {
+                    // Skip outputs already unblinded for a previous notification
+                    if (!m_prewarmed_outputs.find(get_output_key(h2b(output.at("txhash")), output.at("pt_idx")))) {
+                        to_unblind.push_back(&output);
+                    }
+                }
+            }
+            if (to_unblind.empty()) {
+                return;
+            }
 
-                // Note pt_idx on endpoints is the index within the tx, not the previous tx!
-                const uint32_t pt_idx = ep["pt_idx"];
-                auto& m = is_tx_output ? out_map : in_map;
-                GDK_RUNTIME_ASSERT(m.emplace(pt_idx, ep).second);
+            std::vector<cache::liquid_output_t> unblinded;
+            unblind_utxos(to_unblind, m_net_params.policy_asset(), unblinded);
+            if (unblinded.empty()) {
+                return; // Already cached, or awaiting blinding nonces
             }
 
-            // Store the endpoints as inputs/outputs in tx index order
-            nlohmann::json::array_t inputs, outputs;
-            for (auto& it : in_map) {
-                inputs.emplace_back(it.second);
+            locker_t locker(m_mutex);
+            if (m_cache.insert_liquid_outputs(unblinded)) {
+                m_cache.save_db();
             }
-            tx_details["inputs"] = inputs;
+            for (const auto& output : unblinded) {
+                m_prewarmed_outputs.insert(get_output_key(output.txhash, output.vout), true);
+            }
+            GDK_LOG_SEV(log_level::debug) << "prewarmed " << unblinded.size() << " outputs for " << txhashes.size()
+                                          << " txs";
+        });
+    }
 
-            for (auto& it : out_map) {
-                outputs.emplace_back(it.second);
+    void ga_session::format_transaction(nlohmann::json& tx_details, std::vector<cache::liquid_output_t>& unblinded)
+    {
+        const bool is_liquid = m_net_params.is_liquid();
+        const uint32_t tx_block_height = json_add_if_missing(tx_details, "block_height", 0, true);
+        // TODO: Server should set subaccount to null if this is a spend from multiple subaccounts
+        json_add_if_missing(tx_details, "has_payment_request", false);
+        const std::string fee_str = tx_details["fee"];
+        const amount::value_type fee = strtoull(fee_str.c_str(), nullptr, 10);
+        tx_details["fee"] = fee;
+        const std::string tx_data = json_get_value(tx_details, "data");
+        tx_details.erase("data");
+        const uint32_t tx_size = tx_details["size"];
+        tx_details.erase("size");
+        if (!tx_data.empty()) {
+            // Only unconfirmed transactions are returned with the tx hex.
+            // In this case update the size, weight etc.
+            // At the moment to fetch the correct info for confirmed
+            // transactions, callers must call get_transaction_details
+            // on the hash of the confirmed transaction.
+            // Once caching is implemented this info can be populated up
+            // front so callers can always expect it.
+            const auto tx = tx_from_hex(tx_data, tx_flags(is_liquid));
+
+            update_tx_info(m_net_params, tx, tx_details);
+        } else {
+            tx_details["transaction_size"] = tx_size;
+            tx_details["transaction_weight"] = tx_details["vsize"].get<uint32_t>() * 4;
+            json_rename_key(tx_details, "vsize", "transaction_vsize");
+        }
+        // Compute fee in satoshi/kb, with the best integer accuracy we can
+        const uint32_t tx_vsize = tx_details["transaction_vsize"];
+        tx_details["fee_rate"] = fee * 1000 / tx_vsize;
+
+        std::map<std::string, amount> received, spent;
+        std::map<uint32_t, nlohmann::json> in_map, out_map;
+        std::set<std::string> unique_asset_ids;
+
+        // Clean up and categorize the endpoints
+        add_tx_output_txhashes(tx_details);
+        cleanup_utxos(tx_details["eps"], m_net_params.policy_asset(), unblinded);
+
+        for (auto& ep : tx_details["eps"]) {
+            ep.erase("id");
+            json_add_if_missing(ep, "subaccount", 0, true);
+            json_rename_key(ep, "pubkey_pointer", "pointer");
+            json_rename_key(ep, "ad", "address");
+            json_add_if_missing(ep, "pointer", 0, true);
+            json_add_if_missing(ep, "address", std::string(), true);
+            ep.erase("is_credit");
+
+            const bool is_tx_output = json_get_value(ep, "is_output", false);
+            const bool is_relevant = json_get_value(ep, "is_relevant", false);
+
+            if (is_relevant && ep.find("error") == ep.end()) {
+                const auto asset_id = asset_id_from_json(m_net_params, ep);
+                unique_asset_ids.emplace(asset_id);
+
+                // Compute the effect of the input/output on the wallets balance
+                // TODO: Figure out what redeemable value for social payments is about
+                const amount::value_type satoshi = ep.at("satoshi");
+
+                auto& which_balance = is_tx_output ? received[asset_id] : spent[asset_id];
+                which_balance += satoshi;
             }
-            tx_details["outputs"] = outputs;
-            tx_details.erase("eps");
 
-            GDK_RUNTIME_ASSERT(is_liquid || (unique_asset_ids.size() == 1 && *unique_asset_ids.begin() == "btc"));
+            ep["addressee"] = std::string(); // default here, set below where needed
 
-            // TODO: improve the detection of tx type.
-            bool net_positive = false;
-            bool net_positive_set = false;
-            for (const auto& asset_id : unique_asset_ids) {
-                const auto net_received = received[asset_id];
-                const auto net_spent = spent[asset_id];
-                const auto asset_net_positive = net_received > net_spent;
-                if (net_positive_set) {
-                    GDK_RUNTIME_ASSERT_MSG(net_positive == asset_net_positive, "Ambiguous tx direction");
-                } else {
-                    net_positive = asset_net_positive;
-                    net_positive_set = true;
-                }
-                const amount total = net_positive ? net_received - net_spent : net_spent - net_received;
-                tx_details["satoshi"][asset_id] = total.value();
-            }
-
-            const bool is_confirmed = tx_block_height != 0;
-
-            std::vector<std::string> addressees;
-            if (is_liquid && unique_asset_ids.empty()) {
-                // Failed to unblind all relevant inputs and outputs. This
-                // might be a spam transaction.
-                tx_details["type"] = "unblindable";
-                tx_details["can_rbf"] = false;
-                tx_details["can_cpfp"] = false;
-            } else if (net_positive) {
-                for (auto& ep : tx_details["inputs"]) {
-                    std::string addressee;
-                    if (!json_get_value(ep, "is_relevant", false)) {
-                        // Add unique addressees that aren't ourselves
-                        addressee = json_get_value(ep, "social_source");
-                        if (addressee.empty()) {
-                            addressee = json_get_value(ep, "address");
-                        }
-                        if (std::find(std::begin(addressees), std::end(addressees), addressee)
-                            == std::end(addressees)) {
-                            addressees.emplace_back(addressee);
-                        }
-                        ep["addressee"] = addressee;
+            // Note pt_idx on endpoints is the index within the tx, not the previous tx!
+            const uint32_t pt_idx = ep["pt_idx"];
+            auto& m = is_tx_output ? out_map : in_map;
+            GDK_RUNTIME_ASSERT(m.emplace(pt_idx, ep).second);
+        }
+
+        // Store the endpoints as inputs/outputs in tx index order
+        nlohmann::json::array_t inputs, outputs;
+        for (auto& it : in_map) {
+            inputs.emplace_back(it.second);
+        }
+        tx_details["inputs"] = inputs;
+
+        for (auto& it : out_map) {
+            outputs.emplace_back(it.second);
+        }
+        tx_details["outputs"] = outputs;
+        tx_details.erase("eps");
+
+        GDK_RUNTIME_ASSERT(is_liquid || (unique_asset_ids.size() == 1 && *unique_asset_ids.begin() == "btc"));
+
+        // TODO: improve the detection of tx type.
+        bool net_positive = false;
+        bool net_positive_set = false;
+        for (const auto& asset_id : unique_asset_ids) {
+            const auto net_received = received[asset_id];
+            const auto net_spent = spent[asset_id];
+            const auto asset_net_positive = net_received > net_spent;
+            if (net_positive_set) {
+                GDK_RUNTIME_ASSERT_MSG(net_positive == asset_net_positive, "Ambiguous tx direction");
+            } else {
+                net_positive = asset_net_positive;
+                net_positive_set = true;
+            }
+            const amount total = net_positive ? net_received - net_spent : net_spent - net_received;
+            tx_details["satoshi"][asset_id] = total.value();
+        }
+
+        const bool is_confirmed = tx_block_height != 0;
+
+        std::vector<std::string> addressees;
+        if (is_liquid && unique_asset_ids.empty()) {
+            // Failed to unblind all relevant inputs and outputs. This
+            // might be a spam transaction.
+            tx_details["type"] = "unblindable";
+            tx_details["can_rbf"] = false;
+            tx_details["can_cpfp"] = false;
+        } else if (net_positive) {
+            for (auto& ep : tx_details["inputs"]) {
+                std::string addressee;
+                if (!json_get_value(ep, "is_relevant", false)) {
+                    // Add unique addressees that aren't ourselves
+                    addressee = json_get_value(ep, "social_source");
+                    if (addressee.empty()) {
+                        addressee = json_get_value(ep, "address");
+                    }
+                    if (std::find(std::begin(addressees), std::end(addressees), addressee)
+                        == std::end(addressees)) {
+                        addressees.emplace_back(addressee);
                     }
+                    ep["addressee"] = addressee;
                 }
-                tx_details["type"] = "incoming";
-                tx_details["can_rbf"] = false;
-                tx_details["can_cpfp"] = !is_confirmed;
-            } else {
-                for (auto& ep : tx_details["outputs"]) {
-                    if (is_liquid) {
-                        const std::string script = ep["script"];
-                        if (script.empty()) {
-                            continue;
-                        }
+            }
+            tx_details["type"] = "incoming";
+            tx_details["can_rbf"] = false;
+            tx_details["can_cpfp"] = !is_confirmed;
+        } else {
+            for (auto& ep : tx_details["outputs"]) {
+                if (is_liquid) {
+                    const std::string script = ep["script"];
+                    if (script.empty()) {
+                        continue;
                     }
-                    std::string addressee;
-                    if (!json_get_value(ep, "is_relevant", false)) {
-                        // Add unique addressees that aren't ourselves
-                        const auto& social_destination = ep.find("social_destination");
-                        if (social_destination != ep.end()) {
-                            if (social_destination->is_object()) {
-                                addressee = (*social_destination)["name"];
-                            } else {
-                                addressee = *social_destination;
-                            }
+                }
+                std::string addressee;
+                if (!json_get_value(ep, "is_relevant", false)) {
+                    // Add unique addressees that aren't ourselves
+                    const auto& social_destination = ep.find("social_destination");
+                    if (social_destination != ep.end()) {
+                        if (social_destination->is_object()) {
+                            addressee = (*social_destination)["name"];
                         } else {
-                            addressee = ep["address"];
+                            addressee = *social_destination;
                         }
+                    } else {
+                        addressee = ep["address"];
+                    }
 
-                        if (std::find(std::begin(addressees), std::end(addressees), addressee)
-                            == std::end(addressees)) {
-                            addressees.emplace_back(addressee);
-                        }
-                        ep["addressee"] = addressee;
+                    if (std::find(std::begin(addressees), std::end(addressees), addressee)
+                        == std::end(addressees)) {
+                        addressees.emplace_back(addressee);
                     }
+                    ep["addressee"] = addressee;
                 }
-                tx_details["type"] = addressees.empty() ? "redeposit" : "outgoing";
-                tx_details["can_rbf"] = !is_confirmed && json_get_value(tx_details, "rbf_optin", false);
-                tx_details["can_cpfp"] = false;
             }
+            tx_details["type"] = addressees.empty() ? "redeposit" : "outgoing";
+            tx_details["can_rbf"] = !is_confirmed && json_get_value(tx_details, "rbf_optin", false);
+            tx_details["can_cpfp"] = false;
+        }
+        tx_details["addressees"] = addressees;
+        tx_details["user_signed"] = true;
+        tx_details["server_signed"] = true;
+    }
 
+    nlohmann::json ga_session::get_transactions(const nlohmann::json& details)
+    {
+        const uint32_t subaccount = details.at("subaccount");
+        const uint32_t first = details.at("first");
+        const uint32_t count = details.at("count");
+
+        if (json_get_value(details, "clear_cache", false)) {
+            // Clear the tx list cache on user request
+            locker_t locker(m_mutex);
+            m_tx_list_caches.purge_all();
+            m_cache.clear_tx_lists();
+            m_formatted_txs.clear();
+        }
+
+        return format_transactions(subaccount, get_raw_transactions(subaccount, first, count), true);
+    }
+
+    nlohmann::json ga_session::get_transactions_cursor(const nlohmann::json& details)
+    {
+        const uint32_t subaccount = details.at("subaccount");
+        const uint32_t count = json_get_value(details, "count", DEFAULT_CURSOR_COUNT);
+        GDK_RUNTIME_ASSERT_MSG(count != 0 && count <= MAX_CURSOR_COUNT, "Invalid count");
+        {
+            locker_t locker(m_mutex);
+            GDK_RUNTIME_ASSERT_MSG(m_subaccounts.find(subaccount) != m_subaccounts.end(), "Unknown subaccount");
+        }
+        return { { "subaccount", subaccount }, { "count", count }, { "txhash", std::string() }, { "created_at", 0 } };
+    }
+
+    nlohmann::json ga_session::cursor_next(const nlohmann::json& cursor)
+    {
+        const uint32_t subaccount = cursor.at("subaccount");
+        const uint32_t count = cursor.at("count");
+        GDK_RUNTIME_ASSERT_MSG(count != 0 && count <= MAX_CURSOR_COUNT, "Invalid count");
+        tx_list_cache::tx_cursor position{ cursor.at("txhash"), cursor.at("created_at") };
+
+        tx_list_cache::container_type tx_list = get_raw_transactions(subaccount, 0, count, &position);
+        nlohmann::json next_cursor; // Null once all txs have been returned
+        if (tx_list.size() == count) {
+            next_cursor = cursor;
+            next_cursor["txhash"] = position.txhash;
+            next_cursor["created_at"] = position.created_at;
+        }
+        // Pages are not kept for reuse, so that iterating the whole history
+        // does not displace the results of get_transactions
+        auto txs = format_transactions(subaccount, std::move(tx_list), false);
+        return { { "transactions", std::move(txs) }, { "cursor", next_cursor } };
+    }
+
+    nlohmann::json ga_session::format_transactions(
+        uint32_t subaccount, tx_list_cache::container_type tx_list, bool keep_results)
+    {
+        std::vector<bool> is_formatted(tx_list.size());
+        std::vector<uint32_t> spent_counts(tx_list.size());
+        uint64_t memos_version;
+        {
+            // Set tx memos in the returned txs from the blob cache
+            locker_t locker(m_mutex);
+            if (m_blob_outdated) {
+                load_client_blob(locker, true);
+            }
+            memos_version = m_blob.get_tx_memos_version();
+            for (size_t i = 0; i < tx_list.size(); ++i) {
+                auto& tx_details = tx_list[i];
+                const auto txhash = h2b(json_get_value(tx_details, "txhash"));
+                const auto formatted = m_formatted_txs.find(get_formatted_tx_key(subaccount, txhash));
+
+                // Get the tx memo. Use the server provided value if
+                // its present (i.e. no client blob enabled yet, or watch-only).
+                // The blob memo is only looked up if any memo has changed
+                // since our previous result was created.
+                std::string memo = json_get_value(tx_details, "memo");
+                if (memo.empty()) {
+                    if (formatted && formatted->memos_version == memos_version) {
+                        memo = formatted->memo;
+                    } else if (const auto blob_memo = m_blob.get_tx_memo(txhash)) {
+                        memo = *blob_memo;
+                    }
+                }
+
+                // Reuse our previous result if the tx and its memo are unchanged
+                spent_counts[i] = get_spent_count(tx_details);
+                if (formatted && formatted->memo == memo && formatted->spent_count == spent_counts[i]
+                    && formatted->block_height == json_get_value(tx_details, "block_height", 0u)) {
+                    tx_details = formatted->details;
+                    is_formatted[i] = true;
+                } else {
+                    tx_details["memo"] = memo;
+                }
+            }
+        }
+
+        // Format the txs we have no previous results for. Each tx is independent,
+        // so they are formatted in parallel, with the outputs unblinded
+        // while formatting written to the cache together below.
+        std::vector<size_t> to_format;
+        for (size_t i = 0; i < tx_list.size(); ++i) {
+            if (!is_formatted[i]) {
+                to_format.push_back(i);
+            }
+        }
+        std::vector<std::vector<cache::liquid_output_t>> unblinded(to_format.size());
+        const auto post = [this](std::function<void()> task) { asio::post(m_pool, std::move(task)); };
+        parallel_for(
+            to_format.size(), DEFAULT_THREADPOOL_SIZE, post, [this, &tx_list, &to_format, &unblinded](size_t i) {
+                format_transaction(tx_list[to_format[i]], unblinded[i]);
+            });
+
+        // SPV verify serially, since only one blocking header download is made per call
+        const auto datadir = gdk_config().value("datadir", std::string{});
+        const auto path = datadir + "/state";
+        auto is_cached = true;
+        for (const size_t i : to_format) {
+            auto& tx_details = tx_list[i];
             if (m_spv_enabled) {
                 tx_details["spv_verified"] = "in_progress";
                 if (!datadir.empty() && is_cached) {
@@ -2860,11 +3285,29 @@ namespace sdk {
             } else {
                 tx_details["spv_verified"] = "disabled";
             }
-            tx_details["addressees"] = addressees;
-            tx_details["user_signed"] = true;
-            tx_details["server_signed"] = true;
         }
 
+        {
+            // Write the newly unblinded outputs, and keep the newly
+            // processed results for reuse in later calls if requested
+            std::vector<cache::liquid_output_t> outputs;
+            for (auto& tx_outputs : unblinded) {
+                outputs.insert(outputs.end(), std::make_move_iterator(tx_outputs.begin()),
+                    std::make_move_iterator(tx_outputs.end()));
+            }
+            locker_t locker(m_mutex);
+            if (!outputs.empty() && m_cache.insert_liquid_outputs(outputs)) {
+                m_cache.save_db();
+            }
+            for (size_t i = 0; keep_results && i < tx_list.size(); ++i) {
+                const auto& tx_details = tx_list[i];
+                if (!is_formatted[i] && is_final_formatted_tx(tx_details)) {
+                    const auto txhash = h2b(json_get_value(tx_details, "txhash"));
+                    m_formatted_txs.insert(get_formatted_tx_key(subaccount, txhash),
+                        { tx_details["block_height"], spent_counts[i], memos_version, tx_details["memo"], tx_details });
+                }
+            }
+        }
         return tx_list;
     }
 
@@ -2942,7 +3385,7 @@ namespace sdk {
         std::set<std::pair<std::string, std::string>> no_dups;
 
         for (const uint32_t sa : subaccounts) {
-            const auto tx_list = get_raw_transactions(sa, 0, 0xffffffff);
+            const auto tx_list = get_raw_transactions(sa, 0, ALL_TXS);
 
             locker_t locker(m_mutex); // For m_cache
 
@@ -2993,6 +3436,22 @@ namespace sdk {
     {
         locker_t locker(m_mutex);
         m_cache.insert_liquid_blinding_nonce(h2b(pubkey), h2b(script), h2b(nonce));
+        m_formatted_txs.clear(); // Outputs that failed to unblind may now unblind
+    }
+
+    bool ga_session::set_blinding_nonces(const nlohmann::json& nonces)
+    {
+        std::vector<cache::liquid_blinding_nonce_t> rows;
+        rows.reserve(nonces.size());
+        for (const auto& n : nonces) {
+            rows.push_back({ h2b(n.at("pubkey")), h2b(n.at("script")), h2b(n.at("nonce")) });
+        }
+        locker_t locker(m_mutex);
+        if (m_cache.insert_liquid_blinding_nonces(rows) == 0) {
+            return false;
+        }
+        m_formatted_txs.clear(); // Outputs that failed to unblind may now unblind
+        return true;
     }
 
     // Idempotent
@@ -3022,6 +3481,22 @@ namespace sdk {
 
         cleanup_utxos(utxos, m_net_params.policy_asset());
 
+        if (is_liquid && num_confs == 0) {
+            // Keep the cached values and nonces of unspent outputs when the
+            // cache is trimmed at load. Only the full set is recorded, since
+            // results requiring confirmations omit unspent outputs.
+            std::vector<cache::liquid_output_ref_t> unspent;
+            for (const auto& utxo : utxos) {
+                if (utxo.contains("txhash")) {
+                    unspent.emplace_back(get_liquid_output_ref(utxo));
+                }
+            }
+            locker_t locker(m_mutex);
+            if (m_cache.set_liquid_unspent_outputs(subaccount, unspent)) {
+                m_cache.save_db();
+            }
+        }
+
         nlohmann::json asset_utxos({});
         for (const auto& utxo : utxos) {
             if (utxo.contains("error")) {
@@ -3210,6 +3685,8 @@ namespace sdk {
             json_rename_key(address, "num_tx", "tx_count");
             seen_pointer = address["pointer"];
         }
+        // Persist any address scripts derived above
+        m_cache.save_db();
         return nlohmann::json{ { "subaccount", subaccount }, { "last_pointer", seen_pointer }, { "list", addresses } };
     }
 
@@ -3628,11 +4105,28 @@ namespace sdk {
         return m_signer->ae_protocol_support();
     }
 
+    cache::address_script_t ga_session::get_address_script(locker_t& locker, const nlohmann::json& utxo)
+    {
+        GDK_RUNTIME_ASSERT(locker.owns_lock());
+
+        const auto key = get_address_key(utxo);
+        auto& user_pubkeys = get_user_pubkeys(); // Fails if watch-only
+        auto cached = m_cache.get_address_script(key);
+        if (cached) {
+            return std::move(*cached);
+        }
+
+        cache::address_script_t value;
+        value.script = ::ga::sdk::output_script_from_utxo(m_net_params, get_ga_pubkeys(), user_pubkeys,
+            get_recovery_pubkeys(), utxo, value.ga_pub_key, value.user_pub_key);
+        m_cache.insert_address_script(key, value);
+        return value;
+    }
+
     std::vector<unsigned char> ga_session::output_script_from_utxo(const nlohmann::json& utxo)
     {
         locker_t locker(m_mutex);
-        return ::ga::sdk::output_script_from_utxo(
-            m_net_params, get_ga_pubkeys(), get_user_pubkeys(), get_recovery_pubkeys(), utxo);
+        return get_address_script(locker, utxo).script;
     }
 
     std::vector<pub_key_t> ga_session::pubkeys_from_utxo(const nlohmann::json& utxo)
@@ -3641,6 +4135,12 @@ namespace sdk {
         const uint32_t pointer = utxo.at("pointer");
         locker_t locker(m_mutex);
         // TODO: consider returning the recovery key (2of3) as well
+        if (utxo.contains("script_type")) {
+            const auto cached = m_cache.get_address_script(get_address_key(utxo));
+            if (cached) {
+                return std::vector<pub_key_t>({ cached->ga_pub_key, cached->user_pub_key });
+            }
+        }
         return std::vector<pub_key_t>(
             { get_ga_pubkeys().derive(subaccount, pointer), get_user_pubkeys().derive(subaccount, pointer) });
     }
@@ -3708,6 +4208,18 @@ namespace sdk {
         if (decrease != 0) {
             update_spending_limits(locker, tx_details["limits"]);
         }
+        if (m_net_params.is_liquid()) {
+            // The unblinded values of the spent outputs are no longer needed
+            std::vector<cache::liquid_output_ref_t> spent;
+            for (const auto key : { "used_utxos", "old_used_utxos" }) {
+                for (const auto& utxo : json_get_value(details, key, nlohmann::json::array())) {
+                    spent.emplace_back(get_liquid_output_ref(utxo));
+                }
+            }
+            if (m_cache.evict_spent_liquid_outputs(spent)) {
+                m_cache.save_db();
+            }
+        }
 
         // Notify the tx cache that a new tx is expected
         m_tx_list_caches.on_new_transaction(details.at("subaccount"), { { "txhash", txhash_hex } });
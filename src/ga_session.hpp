@@ -5,6 +5,7 @@
 #include <array>
 #include <chrono>
 #include <map>
+#include <set>
 #include <string>
 #include <thread>
 #include <type_traits>
@@ -93,6 +94,8 @@ namespace sdk {
         void change_settings_limits(const nlohmann::json& details, const nlohmann::json& twofactor_data);
 
         nlohmann::json get_transactions(const nlohmann::json& details);
+        nlohmann::json get_transactions_cursor(const nlohmann::json& details);
+        nlohmann::json cursor_next(const nlohmann::json& cursor);
 
         void set_notification_handler(GA_notification_handler handler, void* context);
 
@@ -150,7 +153,8 @@ namespace sdk {
             const std::string& private_key, const std::string& password, uint32_t unused);
         nlohmann::json set_unspent_outputs_status(const nlohmann::json& details, const nlohmann::json& twofactor_data);
         nlohmann::json get_transaction_details(const std::string& txhash) const;
-        tx_list_cache::container_type get_raw_transactions(uint32_t subaccount, uint32_t first, uint32_t count);
+        tx_list_cache::container_type get_raw_transactions(
+            uint32_t subaccount, uint32_t first, uint32_t count, tx_list_cache::tx_cursor* cursor = nullptr);
 
         nlohmann::json create_transaction(const nlohmann::json& details);
         nlohmann::json sign_transaction(const nlohmann::json& details);
@@ -174,6 +178,7 @@ namespace sdk {
         void change_settings_pricing_source(const std::string& currency, const std::string& exchange);
 
         nlohmann::json get_fee_estimates();
+        nlohmann::json get_cache_stats();
 
         std::string get_mnemonic_passphrase(const std::string& password);
 
@@ -186,6 +191,7 @@ namespace sdk {
 
         bool has_blinding_nonce(const std::string& pubkey, const std::string& script);
         void set_blinding_nonce(const std::string& pubkey, const std::string& script, const std::string& nonce);
+        bool set_blinding_nonces(const nlohmann::json& nonces);
         std::vector<unsigned char> get_blinding_nonce(const std::string& pubkey, const std::string& script);
 
         amount get_min_fee_rate() const;
@@ -251,16 +257,27 @@ namespace sdk {
         nlohmann::json convert_fiat_cents(locker_t& locker, amount::value_type fiat_cents) const;
         nlohmann::json get_settings(locker_t& locker);
         virtual nlohmann::json get_all_unspent_outputs(uint32_t subaccount, uint32_t num_confs, bool all_coins);
-        bool unblind_utxo(nlohmann::json& utxo, const std::string& policy_asset);
+        void unblind_utxos(const std::vector<nlohmann::json*>& utxos, const std::string& policy_asset,
+            std::vector<cache::liquid_output_t>& unblinded);
         nlohmann::json cleanup_utxos(nlohmann::json& utxos, const std::string& policy_asset);
-        tx_list_cache::container_type get_tx_list(ga_session::locker_t& locker, uint32_t subaccount, uint32_t page_id,
-            const std::string& start_date, const std::string& end_date, nlohmann::json& state_info);
+        void cleanup_utxos(
+            nlohmann::json& utxos, const std::string& policy_asset, std::vector<cache::liquid_output_t>& unblinded);
+        void format_transaction(nlohmann::json& tx_details, std::vector<cache::liquid_output_t>& unblinded);
+        nlohmann::json format_transactions(
+            uint32_t subaccount, tx_list_cache::container_type tx_list, bool keep_results);
+        tx_list_cache::container_type get_tx_list(uint32_t subaccount, uint32_t page_id, const std::string& start_date,
+            const std::string& end_date, nlohmann::json& state_info);
+        void load_tx_list(locker_t& locker, uint32_t subaccount, tx_list_cache& tx_list);
+        void persist_tx_list(locker_t& locker, uint32_t subaccount, tx_list_cache& tx_list);
+        void update_tx_list_state(locker_t& locker, const nlohmann::json& state_info);
+        void prefetch_transactions(uint32_t subaccount, uint32_t required_cache_size, uint32_t num_pages,
+            uint64_t generation);
+        void prewarm_outputs();
 
         autobahn::wamp_subscription subscribe(
             locker_t& locker, const std::string& topic, const autobahn::wamp_event_handler& callback);
         void call_notification_handler(locker_t& locker, nlohmann::json* details);
 
-        std::unique_ptr<locker_t> get_multi_call_locker(uint32_t category_flags, bool wait_for_lock);
         void on_new_transaction(const std::vector<uint32_t>& subaccounts, nlohmann::json details);
         void on_new_block(nlohmann::json details);
         void on_new_fees(locker_t& locker, const nlohmann::json& details);
@@ -278,9 +295,11 @@ namespace sdk {
 
         nlohmann::json set_fee_estimates(locker_t& locker, const nlohmann::json& fee_estimates);
 
-        nlohmann::json refresh_http_data(const std::string& type, bool refresh);
+        nlohmann::json refresh_http_data(
+            const std::string& type, bool refresh, const std::vector<std::string>& asset_ids);
 
         void update_address_info(nlohmann::json& address, bool is_historic);
+        cache::address_script_t get_address_script(locker_t& locker, const nlohmann::json& utxo);
         std::shared_ptr<nlocktime_t> update_nlocktime_info();
         virtual nlohmann::json fetch_nlocktime_json();
 
@@ -407,8 +426,28 @@ namespace sdk {
         std::vector<std::string> m_tx_notifications;
         std::chrono::system_clock::time_point m_tx_last_notification;
 
-        uint32_t m_multi_call_category;
         tx_list_caches m_tx_list_caches;
+        // Processed get_transactions results by subaccount and txhash, valid while
+        // the tx's block height, spent outputs and memo match those they were
+        // created with. Only the most recently used results are kept
+        struct formatted_tx {
+            uint32_t block_height;
+            uint32_t spent_count;
+            uint64_t memos_version; // The client blob memos version when created
+            std::string memo;
+            nlohmann::json details;
+        };
+        lru_map<formatted_tx> m_formatted_txs;
+        const uint32_t m_tx_prefetch_pages;
+        // The most recent Liquid outputs of notified txs unblinded in the
+        // background, and the number of times a caller has found one of them
+        // in the cache
+        const bool m_prewarm_outputs;
+        lru_map<bool> m_prewarmed_outputs;
+        uint64_t m_prewarm_hits;
+        // Notified txs and their subaccounts awaiting the pending prewarm
+        std::set<std::string> m_prewarm_txhashes;
+        std::set<uint32_t> m_prewarm_subaccounts;
         std::shared_ptr<nlocktime_t> m_nlocktimes;
 
         std::shared_ptr<tor_controller> m_tor_ctrl;
@@ -510,6 +510,22 @@ namespace sdk {
         });
     }
 
+    nlohmann::json session::get_transactions_cursor(const nlohmann::json& details)
+    {
+        return exception_wrapper([&] {
+            auto p = get_nonnull_impl();
+            return p->get_transactions_cursor(details);
+        });
+    }
+
+    nlohmann::json session::cursor_next(const nlohmann::json& cursor)
+    {
+        return exception_wrapper([&] {
+            auto p = get_nonnull_impl();
+            return p->cursor_next(cursor);
+        });
+    }
+
     void session::set_notification_handler(GA_notification_handler handler, void* context)
     {
         auto p = get_impl();
@@ -762,6 +778,14 @@ namespace sdk {
         });
     }
 
+    bool session::set_blinding_nonces(const nlohmann::json& nonces)
+    {
+        return exception_wrapper([&] {
+            auto p = get_nonnull_impl();
+            return p->set_blinding_nonces(nonces);
+        });
+    }
+
     nlohmann::json session::get_unspent_outputs_for_private_key(
         const std::string& private_key, const std::string& password, uint32_t unused)
     {
@@ -904,6 +928,14 @@ namespace sdk {
         });
     }
 
+    nlohmann::json session::get_cache_stats()
+    {
+        return exception_wrapper([&] {
+            auto p = get_nonnull_impl();
+            return p->get_cache_stats();
+        });
+    }
+
     std::string session::get_mnemonic_passphrase(const std::string& password)
     {
         return exception_wrapper([&] {
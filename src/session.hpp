@@ -75,6 +75,8 @@ namespace sdk {
         void change_settings_limits(const nlohmann::json& limit_details, const nlohmann::json& twofactor_data);
 
         nlohmann::json get_transactions(const nlohmann::json& details);
+        nlohmann::json get_transactions_cursor(const nlohmann::json& details);
+        nlohmann::json cursor_next(const nlohmann::json& cursor);
 
         void set_notification_handler(GA_notification_handler handler, void* context);
 
@@ -136,6 +138,7 @@ namespace sdk {
 
         bool has_blinding_nonce(const std::string& pubkey, const std::string& script);
         void set_blinding_nonce(const std::string& pubkey, const std::string& script, const std::string& nonce);
+        bool set_blinding_nonces(const nlohmann::json& nonces);
 
         nlohmann::json create_transaction(const nlohmann::json& details);
         nlohmann::json sign_transaction(const nlohmann::json& details);
@@ -157,6 +160,7 @@ namespace sdk {
         void upload_confidential_addresses(uint32_t subaccount, const std::vector<std::string>& confidential_addresses);
 
         nlohmann::json get_fee_estimates();
+        nlohmann::json get_cache_stats();
 
         std::string get_mnemonic_passphrase(const std::string& password);
 
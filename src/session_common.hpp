@@ -77,6 +77,8 @@ namespace sdk {
         virtual void change_settings_limits(const nlohmann::json& limit_details, const nlohmann::json& twofactor_data)
             = 0;
         virtual nlohmann::json get_transactions(const nlohmann::json& details) = 0;
+        virtual nlohmann::json get_transactions_cursor(const nlohmann::json& details) = 0;
+        virtual nlohmann::json cursor_next(const nlohmann::json& cursor) = 0;
 
         virtual void set_notification_handler(GA_notification_handler handler, void* context) = 0;
 
@@ -134,6 +136,7 @@ namespace sdk {
 
         virtual void set_blinding_nonce(const std::string& pubkey, const std::string& script, const std::string& nonce)
             = 0;
+        virtual bool set_blinding_nonces(const nlohmann::json& nonces) = 0;
         virtual bool has_blinding_nonce(const std::string& pubkey, const std::string& script) = 0;
         virtual nlohmann::json get_blinded_scripts(const nlohmann::json& details) = 0;
         virtual void upload_confidential_addresses(
@@ -172,6 +175,8 @@ namespace sdk {
 
         virtual nlohmann::json get_fee_estimates() = 0;
 
+        virtual nlohmann::json get_cache_stats() = 0;
+
         virtual std::string get_mnemonic_passphrase(const std::string& password) = 0;
 
         virtual std::string get_system_message() = 0;
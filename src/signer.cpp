@@ -1,5 +1,6 @@
 #include "signer.hpp"
 #include "network_parameters.hpp"
+#include "threading.hpp"
 #include "utils.hpp"
 
 namespace ga {
@@ -163,6 +164,9 @@ namespace sdk {
         if (m_master_blinding_key) {
             wally_bzero(m_master_blinding_key->data(), m_master_blinding_key->size());
         }
+        for (auto& entry : m_blinding_keys) {
+            wally_bzero(entry.private_key.data(), entry.private_key.size());
+        }
     }
 
     bool software_signer::supports_low_r() const { return true; }
@@ -208,8 +212,56 @@ namespace sdk {
 
     priv_key_t software_signer::get_blinding_key_from_script(byte_span_t script)
     {
+        std::unique_lock<std::mutex> locker(m_blinding_keys_mutex);
+        return get_blinding_key_entry(locker, script).private_key;
+    }
+
+    std::vector<unsigned char> software_signer::get_public_key_from_blinding_key(byte_span_t script)
+    {
+        std::unique_lock<std::mutex> locker(m_blinding_keys_mutex);
+        auto& entry = get_blinding_key_entry(locker, script);
+        if (entry.public_key.empty()) {
+            entry.public_key = ec_public_key_from_private_key(entry.private_key);
+        }
+        return entry.public_key;
+    }
+
+    software_signer::blinding_key_entry& software_signer::get_blinding_key_entry(
+        std::unique_lock<std::mutex>& locker, byte_span_t script)
+    {
+        GDK_RUNTIME_ASSERT(locker.owns_lock());
+        const auto p = m_blinding_key_index.find(script);
+        if (p) {
+            // Move to the front as the most recently used
+            m_blinding_keys.splice(m_blinding_keys.begin(), m_blinding_keys, *p);
+            return m_blinding_keys.front();
+        }
+
         GDK_RUNTIME_ASSERT(m_master_blinding_key.has_value());
-        return asset_blinding_key_to_ec_private_key(*m_master_blinding_key, script);
+        priv_key_t private_key;
+        {
+            // Derive the key without blocking other threads
+            unique_unlock unlocker(locker);
+            private_key = asset_blinding_key_to_ec_private_key(*m_master_blinding_key, script);
+        }
+        if (const auto q = m_blinding_key_index.find(script)) {
+            // Another thread added this key while we were unlocked
+            wally_bzero(private_key.data(), private_key.size());
+            m_blinding_keys.splice(m_blinding_keys.begin(), m_blinding_keys, *q);
+            return m_blinding_keys.front();
+        }
+
+        if (m_blinding_keys.size() >= BLINDING_KEY_CACHE_SIZE) {
+            // Evict the least recently used key
+            auto& evicted = m_blinding_keys.back();
+            m_blinding_key_index.erase(evicted.script);
+            wally_bzero(evicted.private_key.data(), evicted.private_key.size());
+            m_blinding_keys.pop_back();
+        }
+        m_blinding_keys.push_front({ std::vector<unsigned char>(script.begin(), script.end()), private_key, {} });
+        wally_bzero(private_key.data(), private_key.size());
+        m_blinding_key_index.insert(script, m_blinding_keys.begin());
+        return m_blinding_keys.front();
     }
 
     //
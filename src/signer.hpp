@@ -3,9 +3,12 @@
 #pragma once
 
 #include "boost_wrapper.hpp"
+#include "containers.hpp"
 #include "ga_wally.hpp"
 #include "gsl_wrapper.hpp"
 #include "memory.hpp"
+#include <list>
+#include <mutex>
 #include <nlohmann/json.hpp>
 
 namespace ga {
@@ -136,10 +139,31 @@ namespace sdk {
 
         ecdsa_sig_t sign_hash(uint32_span_t path, byte_span_t hash) override;
         priv_key_t get_blinding_key_from_script(byte_span_t script) override;
+        std::vector<unsigned char> get_public_key_from_blinding_key(byte_span_t script) override;
 
     private:
+        // The number of per-script blinding keys to keep
+        static constexpr size_t BLINDING_KEY_CACHE_SIZE = 1024;
+
+        // A script's blinding key, and its public key once derived
+        struct blinding_key_entry {
+            std::vector<unsigned char> script;
+            priv_key_t private_key;
+            std::vector<unsigned char> public_key;
+        };
+        using blinding_key_list_t = std::list<blinding_key_entry>;
+
+        // Return the cached entry for 'script', adding it if missing.
+        // The returned entry is only valid while m_blinding_keys_mutex is held.
+        blinding_key_entry& get_blinding_key_entry(std::unique_lock<std::mutex>& locker, byte_span_t script);
+
         wally_ext_key_ptr m_master_key;
         boost::optional<blinding_key_t> m_master_blinding_key;
+        // Least recently used cache of blinding keys derived from m_master_blinding_key,
+        // most recently used first. Evicted keys are zeroed.
+        std::mutex m_blinding_keys_mutex;
+        blinding_key_list_t m_blinding_keys;
+        open_hash_map<blinding_key_list_t::iterator> m_blinding_key_index; // Script to entry
     };
 
     //
@@ -507,6 +507,7 @@ LOCALFUNC jbyteArray create_array(JNIEnv *jenv, const unsigned char* p, size_t l
 %returns_struct(GA_get_available_currencies, GA_json)
 %returns_struct(GA_get_balance, GA_auth_handler)
 %returns_struct(GA_get_fee_estimates, GA_json)
+%returns_struct(GA_get_cache_stats, GA_json)
 %returns_string(GA_get_mnemonic_passphrase)
 %returns_struct(GA_get_networks, GA_json)
 %returns_struct(GA_get_previous_addresses, GA_auth_handler)
@@ -519,10 +520,13 @@ LOCALFUNC jbyteArray create_array(JNIEnv *jenv, const unsigned char* p, size_t l
 %returns_struct(GA_update_subaccount, GA_auth_handler)
 %returns_string(GA_get_system_message)
 %returns_struct(GA_get_transactions, GA_auth_handler)
+%returns_struct(GA_get_transactions_cursor, GA_json)
+%returns_struct(GA_cursor_next, GA_auth_handler)
 %returns_struct(GA_get_twofactor_config, GA_json)
 %returns_struct(GA_get_unspent_outputs, GA_auth_handler)
 %returns_struct(GA_get_unspent_outputs_for_private_key, GA_json)
 %returns_struct(GA_set_unspent_outputs_status, GA_auth_handler)
+%returns_void__(GA_set_blinding_nonces)
 %returns_struct(GA_get_receive_address, GA_auth_handler)
 %returns_void__(GA_login_watch_only)
 %returns_struct(GA_login_with_pin, GA_auth_handler)
@@ -2,6 +2,12 @@
 #define GDK_THREADING_HPP
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <mutex>
 
 namespace ga {
@@ -38,6 +44,56 @@ namespace sdk {
         std::unique_lock<std::mutex>& m_locker;
     };
 
+    // Call fn(i) for each i in [0, count), using the calling thread and up to
+    // 'num_helpers' tasks submitted with 'post' (e.g. to a thread pool).
+    // Indices are claimed by whichever thread is free first, so the caller
+    // never waits for a task that has not started and can complete all the
+    // work itself if the pool is busy. Rethrows the first exception thrown.
+    template <typename Fn>
+    void parallel_for(
+        size_t count, size_t num_helpers, const std::function<void(std::function<void()>)>& post, Fn&& fn)
+    {
+        struct state_t {
+            std::atomic<size_t> next{ 0 };
+            std::mutex mutex;
+            std::condition_variable done_cv;
+            size_t done = 0;
+            std::exception_ptr error;
+        };
+        auto state = std::make_shared<state_t>();
+        const std::function<void(size_t)> call_fn = std::forward<Fn>(fn);
+
+        // Helpers only reference 'call_fn' while an index remains unclaimed,
+        // during which the caller is waiting below, keeping it alive
+        const auto run = [state, &call_fn, count] {
+            for (size_t i = state->next++; i < count; i = state->next++) {
+                std::exception_ptr error;
+                try {
+                    call_fn(i);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                std::lock_guard<std::mutex> locker(state->mutex);
+                if (error && !state->error) {
+                    state->error = error;
+                }
+                if (++state->done == count) {
+                    state->done_cv.notify_one();
+                }
+            }
+        };
+        for (size_t i = 0; i < std::min(num_helpers, count ? count - 1 : 0); ++i) {
+            post(run);
+        }
+        run();
+
+        std::unique_lock<std::mutex> locker(state->mutex);
+        state->done_cv.wait(locker, [&state, count] { return state->done == count; });
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
 } // namespace sdk
 } // namespace ga
 
@@ -180,6 +180,15 @@ namespace sdk {
 
     std::vector<unsigned char> output_script_from_utxo(const network_parameters& net_params, ga_pubkeys& pubkeys,
         user_pubkeys& usr_pubkeys, user_pubkeys& recovery_pubkeys, const nlohmann::json& utxo)
+    {
+        pub_key_t ga_pub_key, user_pub_key;
+        return output_script_from_utxo(
+            net_params, pubkeys, usr_pubkeys, recovery_pubkeys, utxo, ga_pub_key, user_pub_key);
+    }
+
+    std::vector<unsigned char> output_script_from_utxo(const network_parameters& net_params, ga_pubkeys& pubkeys,
+        user_pubkeys& usr_pubkeys, user_pubkeys& recovery_pubkeys, const nlohmann::json& utxo,
+        pub_key_t& ga_pub_key, pub_key_t& user_pub_key)
     {
         const uint32_t subaccount = json_get_value(utxo, "subaccount", 0u);
         const uint32_t pointer = utxo.at("pointer");
@@ -195,8 +204,8 @@ namespace sdk {
             GDK_RUNTIME_ASSERT_MSG(csv_bucket_p != csv_buckets.end(), "Unknown csv bucket");
         }
 
-        const auto ga_pub_key = pubkeys.derive(subaccount, pointer);
-        const auto user_pub_key = usr_pubkeys.derive(subaccount, pointer);
+        ga_pub_key = pubkeys.derive(subaccount, pointer);
+        user_pub_key = usr_pubkeys.derive(subaccount, pointer);
 
         if (recovery_pubkeys.have_subaccount(subaccount)) {
             // 2of3
@@ -501,5 +510,29 @@ namespace sdk {
         }
     }
 
+    void add_tx_output_txhashes(nlohmann::json& tx_details)
+    {
+        const std::string txhash = tx_details.at("txhash");
+        for (auto& ep : tx_details.at("eps")) {
+            if (json_get_value(ep, "is_output", false)) {
+                json_add_if_missing(ep, "txhash", txhash);
+            }
+        }
+    }
+
+    bool is_final_formatted_tx(const nlohmann::json& tx_details)
+    {
+        if (tx_details.at("spv_verified") == "in_progress") {
+            return false;
+        }
+        const auto is_pending = [](const nlohmann::json& ep) {
+            return json_get_value(ep, "error") == "missing blinding nonce";
+        };
+        const auto& inputs = tx_details.at("inputs");
+        const auto& outputs = tx_details.at("outputs");
+        return std::none_of(inputs.begin(), inputs.end(), is_pending)
+            && std::none_of(outputs.begin(), outputs.end(), is_pending);
+    }
+
 } // namespace sdk
 } // namespace ga
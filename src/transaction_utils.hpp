@@ -48,6 +48,11 @@ namespace sdk {
     std::vector<unsigned char> output_script_from_utxo(const network_parameters& net_params, ga_pubkeys& pubkeys,
         user_pubkeys& usr_pubkeys, user_pubkeys& recovery_pubkeys, const nlohmann::json& utxo);
 
+    // As above, also returning the derived GA and user pubkeys
+    std::vector<unsigned char> output_script_from_utxo(const network_parameters& net_params, ga_pubkeys& pubkeys,
+        user_pubkeys& usr_pubkeys, user_pubkeys& recovery_pubkeys, const nlohmann::json& utxo,
+        pub_key_t& ga_pub_key, pub_key_t& user_pub_key);
+
     // Returns the asset id, or "btc" if it matches the networks policy asset
     std::string asset_id_from_json(const network_parameters& net_params, const nlohmann::json& json);
 
@@ -98,6 +103,16 @@ namespace sdk {
 
     // Set the locktime on tx to avoid fee sniping
     void set_anti_snipe_locktime(const wally_tx_ptr& tx, uint32_t current_block_height);
+
+    // Add the txhash to the output endpoints of a tx from the server, which
+    // returns them without one, so that their unblinding results can be cached
+    void add_tx_output_txhashes(nlohmann::json& tx_details);
+
+    // Whether a formatted tx can be reused until its block height, memo or
+    // spent outputs change. Txs still being SPV verified or awaiting blinding
+    // nonces from a hardware wallet must be formatted again. Endpoints that
+    // failed to unblind would fail again, so don't prevent reuse.
+    bool is_final_formatted_tx(const nlohmann::json& tx_details);
 } // namespace sdk
 } // namespace ga
 
@@ -1,9 +1,12 @@
 #include <algorithm>
+#include <limits>
 
 #include "assertion.hpp"
 #include "boost_wrapper.hpp"
 #include "containers.hpp"
+#include "ga_wally.hpp"
 #include "logging.hpp"
+#include "threading.hpp"
 #include "tx_list_cache.hpp"
 
 #if 0 // Change to 1 for info level debug output
@@ -30,6 +33,11 @@ namespace sdk {
      *   3) Logging out/back in.
      * - For 1) We must delete all mempool txs, since an incoming tx may double spend
      *   (or confirm) any unconfirmed tx. Any confirmed txs can remain cached.
+     *   In targeted mode, we instead delete only the notified tx if cached, and any
+     *   mempool txs that it spends from or double spends. Mempool txs are returned
+     *   with their tx hex, from which we record the outputs each one spends. A new
+     *   tx is only checked once it is fetched. Any tx whose spent outputs are unknown
+     *   (e.g. a new tx that has already confirmed) falls back to deleting all mempool txs.
      * - For 2), We must delete all mempool txs and additionally all txs younger than
      *   the re-org'd block (since the mempool will change if txs re-enter it, and txs
      *   after the re-org point may be in different blocks or dropped).
@@ -37,6 +45,9 @@ namespace sdk {
      *   so remove N blocks from the results where N is the largest expected re-org.
      *   However when reconnecting, if we have not missed a block notification this
      *   can be avoided (TODO).
+     * - Confirmed txs older than the last mempool tx are persisted between logins. Each
+     *   is stored under an ordinal which is fixed while it remains cached, with older
+     *   txs having lower ordinals. On login they are loaded and trimmed as per 3).
      * - The timestamp of the transaction is the server sort key, but this timestamp
      *   is set when the signed tx is entered into the servers database.
      * - As such, a mempool tx may appear later in the list returned from the server
@@ -54,36 +65,119 @@ namespace sdk {
      * - Note that the start and end date passed are absolute regardless of sort order;
      *   start date is inclusive while end date is not; and the default sort order (which
      *   is what we use) means their meanings are reversed from what you'd normally expect.
+     * - When the entire history is required, the time before the oldest cached tx is
+     *   split into disjoint date windows which are fetched concurrently. Since each
+     *   window is returned newest first, appending them in order gives the txs in
+     *   timestamp order. The oldest window has no start date, so that no txs are
+     *   missed if the wallet's creation time is inaccurate.
      * - The above holds true given the information currently returned from the server,
      *   it would be possible to be more efficient if more information is notified in
      *   the future and/or the server data is returned in a more efficient manner.
      */
     namespace {
         static constexpr size_t TXS_PER_PAGE = 30u; // Number of txs per page the server returns
+        // Don't compact the arena until it has at least this many unused bytes
+        static constexpr size_t MIN_ARENA_COMPACT_BYTES = 64 * 1024;
 
-        // Find the last instance of a cache item matching predicate 'fn'
-        template <typename FN> static iterator find_last_of(container_type& cache, const FN& fn)
+        using tx_record = tx_list_cache::tx_record;
+
+        // The txhash and timestamp of a tx, used to limit server queries
+        struct tx_bound {
+            std::string txhash;
+            int64_t created_at;
+        };
+
+        // Convert between dates and days since the epoch in the proleptic
+        // Gregorian calendar. See http://howardhinnant.github.io/date_algorithms.html
+        static int64_t days_from_civil(int64_t y, uint32_t m, uint32_t d)
+        {
+            y -= m <= 2;
+            const int64_t era = (y >= 0 ? y : y - 399) / 400;
+            const uint32_t yoe = static_cast<uint32_t>(y - era * 400);
+            const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+            const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+            return era * 146097 + static_cast<int64_t>(doe) - 719468;
+        }
+
+        static void civil_from_days(int64_t z, int64_t& y, uint32_t& m, uint32_t& d)
+        {
+            z += 719468;
+            const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+            const uint32_t doe = static_cast<uint32_t>(z - era * 146097);
+            const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+            const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+            const uint32_t mp = (5 * doy + 2) / 153;
+            d = doy - (153 * mp + 2) / 5 + 1;
+            m = mp < 10 ? mp + 3 : mp - 9;
+            y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+        }
+
+        static bool parse_digits(const char* p, size_t n, uint32_t& value)
         {
-            auto last = cache.end();
-            for (auto i = cache.begin(); i != cache.end(); ++i) {
-                if (fn(*i)) {
-                    last = i;
+            value = 0;
+            for (size_t i = 0; i < n; ++i) {
+                if (p[i] < '0' || p[i] > '9') {
+                    return false;
                 }
+                value = value * 10 + static_cast<uint32_t>(p[i] - '0');
             }
-            return last;
+            return true;
         }
 
-        // Return a date 'num_seconds' seconds after the given date, in the
-        // format expected for GA transaction queries.
-        std::string get_query_date(const std::string& date, uint32_t num_seconds)
+        static void put_digits(char* p, size_t n, uint32_t value)
         {
-            // Server returned 'created_at' format is "YYYY-MM-DD HH:SS:MM"
-            // Server expected query format is "YYYY-MM-DDTHH:SS:MM.000Z"
+            for (size_t i = n; i > 0; --i) {
+                p[i - 1] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+        }
+
+        // Parse the server returned 'created_at' format "YYYY-MM-DD HH:MM:SS"
+        static int64_t get_created_at(const nlohmann::json& tx)
+        {
+            const std::string& created_at = tx.at("created_at").get_ref<const std::string&>();
+            const char* p = created_at.c_str();
+            uint32_t y, mon, d, h, min, s;
+            if (created_at.size() >= 19 && p[4] == '-' && p[7] == '-' && p[10] == ' ' && p[13] == ':' && p[16] == ':'
+                && parse_digits(p, 4, y) && parse_digits(p + 5, 2, mon) && parse_digits(p + 8, 2, d)
+                && parse_digits(p + 11, 2, h) && parse_digits(p + 14, 2, min) && parse_digits(p + 17, 2, s)
+                && mon >= 1 && mon <= 12 && d >= 1 && d <= 31) {
+                return days_from_civil(y, mon, d) * 86400 + h * 3600 + min * 60 + s;
+            }
+            // Unexpected format: let boost handle it
             using namespace boost::posix_time;
-            auto dt = to_iso_extended_string(time_from_string(date) + seconds(num_seconds));
-            std::vector<std::string> dt_parts;
-            boost::algorithm::split(dt_parts, dt, boost::is_any_of(","));
-            return dt_parts.front() + ".000Z";
+            const ptime epoch(boost::gregorian::date(1970, 1, 1));
+            return (time_from_string(created_at) - epoch).total_seconds();
+        }
+
+        static tx_bound get_bound(const nlohmann::json& tx)
+        {
+            return { json_get_value(tx, "txhash"), get_created_at(tx) };
+        }
+
+        static tx_bound get_bound(const tx_record& record) { return { b2h(record.txhash), record.created_at }; }
+
+        // Return a date 'num_seconds' seconds after the given time, in the
+        // format expected for GA transaction queries.
+        std::string get_query_date(int64_t created_at, uint32_t num_seconds)
+        {
+            // Server expected query format is "YYYY-MM-DDTHH:MM:SS.000Z"
+            const int64_t t = created_at + num_seconds;
+            const int64_t days = (t >= 0 ? t : t - 86399) / 86400;
+            const uint32_t secs = static_cast<uint32_t>(t - days * 86400);
+            int64_t y;
+            uint32_t m, d;
+            civil_from_days(days, y, m, d);
+            GDK_RUNTIME_ASSERT(y >= 0 && y <= 9999);
+
+            char buf[] = "YYYY-MM-DDTHH:MM:SS.000Z";
+            put_digits(buf, 4, static_cast<uint32_t>(y));
+            put_digits(buf + 5, 2, m);
+            put_digits(buf + 8, 2, d);
+            put_digits(buf + 11, 2, secs / 3600);
+            put_digits(buf + 14, 2, secs / 60 % 60);
+            put_digits(buf + 17, 2, secs % 60);
+            return std::string(buf, sizeof(buf) - 1);
         }
 
         void filter_replaced_by(container_type& txs)
@@ -95,7 +189,7 @@ namespace sdk {
                 txs.end());
         }
 
-        static void dump_cache(const container_type& cache, const std::string& message)
+        static void dump_cache(const std::deque<tx_record>& cache, const std::string& message)
         {
 #if 0 // Change to 1 for cache dumping
             std::ostringstream os;
@@ -103,9 +197,9 @@ namespace sdk {
             if (cache.empty()) {
                 os << "(empty)";
             }
-            for (const auto& tx : cache) {
-                os << "(<" << json_get_value(tx, "block_height", 0) << "> " << json_get_value(tx, "created_at") << " {"
-                   << json_get_value(tx, "txhash") << "}),";
+            for (const auto& record : cache) {
+                os << "(<" << record.block_height << "> " << record.created_at << " {" << b2h(record.txhash)
+                   << "}),";
             }
             GDK_LOG_SEV(cache_log_level) << os.str();
 #else
@@ -131,14 +225,12 @@ namespace sdk {
 #endif
         }
 
-        static auto fetch_txs(
-            const value_type* start_tx, const value_type* end_tx, nlohmann::json& state_info, get_txs_fn_t get_txs)
+        static auto fetch_txs(const tx_bound* start_tx, const tx_bound* end_tx, nlohmann::json& state_info,
+            get_txs_fn_t get_txs, tx_list_stats& stats)
         {
-            const std::string start_at = start_tx ? json_get_value(*start_tx, "created_at") : std::string();
-            const std::string start_date = start_tx ? get_query_date(start_at, 0) : std::string();
-            const std::string end_at = end_tx ? json_get_value(*end_tx, "created_at") : std::string();
-            const std::string end_date = end_tx ? get_query_date(end_at, 1) : std::string();
-            std::string latest_end_at;
+            const std::string start_date = start_tx ? get_query_date(start_tx->created_at, 0) : std::string();
+            const std::string end_date = end_tx ? get_query_date(end_tx->created_at, 1) : std::string();
+            int64_t latest_end_at = -1;
             // Load all pages with the same created_at date at once. This can realistically
             // only happen in test environments; Loading all of them prevents us having to
             // deal with several ugly special cases.
@@ -147,8 +239,10 @@ namespace sdk {
             container_type page_txs;
             do {
                 container_type tmp(get_txs(page, start_date, end_date, state_info));
+                ++stats.server_calls;
+                stats.fetched_txs += tmp.size();
                 if (!tmp.empty()) {
-                    latest_end_at = json_get_value(tmp.front(), "created_at");
+                    latest_end_at = get_created_at(tmp.front());
                 }
                 page_tx_count = tmp.size();
                 filter_replaced_by(tmp);
@@ -156,7 +250,7 @@ namespace sdk {
                 page_txs.insert(
                     page_txs.end(), std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
                 ++page;
-            } while (latest_end_at == end_at && page_tx_count == TXS_PER_PAGE);
+            } while (end_tx && latest_end_at == end_tx->created_at && page_tx_count == TXS_PER_PAGE);
             GDK_RUNTIME_ASSERT_MSG(!end_tx || !page_txs.empty(), "Expected at least one transaction");
 
             bool is_last_page = page_tx_count != TXS_PER_PAGE;
@@ -165,7 +259,7 @@ namespace sdk {
             // end_tx with the same timestamp, so we must skip to our last cached end_tx + 1
             // to ignore any txs we already have cached.
             if (end_tx) {
-                const std::string end_txhash = json_get_value(*end_tx, "txhash");
+                const std::string& end_txhash = end_tx->txhash;
                 auto tx_eq = [&end_txhash](const value_type& tx) { return tx["txhash"] == end_txhash; };
                 auto p = std::find_if(page_txs.begin(), page_txs.end(), tx_eq);
                 GDK_RUNTIME_ASSERT_MSG(p != page_txs.end(), "Last cached tx not found");
@@ -173,7 +267,7 @@ namespace sdk {
             }
 
             if (start_tx) {
-                const std::string start_txhash = json_get_value(*start_tx, "txhash");
+                const std::string& start_txhash = start_tx->txhash;
                 auto tx_eq = [&start_txhash](const value_type& tx) { return tx["txhash"] == start_txhash; };
                 auto p = std::find_if(page_txs.begin(), page_txs.end(), tx_eq);
                 if (p != page_txs.end()) {
@@ -187,23 +281,101 @@ namespace sdk {
 
             return std::make_pair(page_txs, is_last_page);
         }
+
+        // Fetch every tx created in [start, end), newest first. A start of 0 is unbounded
+        static container_type fetch_window(
+            int64_t start, int64_t end, nlohmann::json& state_info, get_txs_fn_t get_txs, tx_list_stats& stats)
+        {
+            const std::string start_date = start ? get_query_date(start, 0) : std::string();
+            const std::string end_date = get_query_date(end, 0);
+            uint32_t page = 0;
+            size_t page_tx_count;
+            container_type txs;
+            do {
+                container_type tmp(get_txs(page, start_date, end_date, state_info));
+                ++stats.server_calls;
+                stats.fetched_txs += tmp.size();
+                page_tx_count = tmp.size();
+                filter_replaced_by(tmp);
+                txs.insert(txs.end(), std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
+                ++page;
+            } while (page_tx_count == TXS_PER_PAGE);
+            return txs;
+        }
+
+        static void merge_state_info(nlohmann::json& state_info, const nlohmann::json& other)
+        {
+            if (other["cur_block"] > state_info["cur_block"]) {
+                state_info["cur_block"] = other["cur_block"];
+            }
+            if (!other["fiat_exchange"].is_null()) {
+                state_info["fiat_exchange"] = other["fiat_exchange"];
+            }
+        }
     } // namespace
 
-    tx_list_cache::get_fn_ret_t tx_list_cache::get(uint32_t first, uint32_t count, get_txs_fn_t get_txs)
+    nlohmann::json tx_list_stats::to_json() const
     {
-        const auto move_iter = std::make_move_iterator<iterator>;
+        return { { "notifications", notifications.load() }, { "evicted_txs", evicted_txs.load() },
+            { "fetched_txs", fetched_txs.load() }, { "server_calls", server_calls.load() } };
+    }
 
+    tx_list_cache::tx_list_cache(bool is_liquid, bool is_targeted, std::shared_ptr<tx_list_stats> stats)
+        : m_is_liquid(is_liquid)
+        , m_is_targeted(is_targeted)
+        , m_stats(std::move(stats))
+    {
+        GDK_RUNTIME_ASSERT(m_stats != nullptr);
+    }
+
+    tx_list_cache::get_fn_ret_t tx_list_cache::get(uint32_t first, uint32_t count, get_txs_fn_t get_txs)
+    {
         const uint32_t required_cache_size = first + count;
         nlohmann::json state_info = { { "cur_block", 0u }, { "fiat_exchange", nullptr } };
-        container_type page_txs;
-        bool is_last_page;
 
-        dump_cache(m_tx_cache, "before get");
+        dump_cache(m_records, "before get");
 
-        if (m_is_front_dirty) {
-            // Load any new txs we need from the server
-            container_type txs;
+        refresh_front(required_cache_size, state_info, get_txs);
+
+        // At this point, the cache contains the newest txs from the server, followed
+        // by any txs we already had cached.
 
+        if (m_records.empty()) {
+            // The caller has no txs.
+            return std::make_pair(container_type(), state_info);
+        }
+
+        // Load any older txs we need from the server
+        fetch_older(required_cache_size, std::numeric_limits<uint32_t>::max(), state_info, get_txs);
+
+        if (first >= m_records.size()) {
+            // Caller is asking for txs beyond the cache size.
+            return std::make_pair(container_type(), state_info);
+        }
+
+        // return results from the cached txs
+        const size_t finish = first + std::min<size_t>(count, m_records.size() - first);
+        container_type result;
+        for (size_t i = first; i < finish; ++i) {
+            const auto tx = get_encoded_tx(m_records[i]);
+            result.emplace_back(nlohmann::json::from_msgpack(tx.begin(), tx.end()));
+        }
+
+        dump_cache(m_records, " after get");
+        return std::make_pair(std::move(result), state_info);
+    }
+
+    void tx_list_cache::refresh_front(uint32_t required_cache_size, nlohmann::json& state_info, get_txs_fn_t get_txs)
+    {
+        const auto move_iter = std::make_move_iterator<iterator>;
+        container_type page_txs;
+        bool is_last_page;
+
+        // Load any new txs we need from the server
+        container_type txs;
+        size_t num_checked = 0; // The number of txs checked for invalidated cached txs
+        std::vector<std::array<unsigned char, 32>> removed; // Txs removed as invalidated
+        while (m_is_front_dirty) {
             if (m_oldest_txhash == "none") {
                 // Previously we had no txs fetched from the server, but we
                 // need to re-check since the front of the cache is dirty.
@@ -214,66 +386,160 @@ namespace sdk {
                 // We need to load the newest txs from the server, until we either
                 // A) See all txs or the tx at the start of our cache, OR
                 // B) Have loaded up to 'required_cache_size' items (if our cache is empty)
-                const value_type* start_tx = m_tx_cache.empty() ? nullptr : &m_tx_cache.front();
-                const value_type* end_tx = txs.empty() ? nullptr : &txs.back();
-                std::tie(page_txs, is_last_page) = fetch_txs(start_tx, end_tx, state_info, get_txs);
+                tx_bound start_bound, end_bound;
+                const tx_bound* start_tx = nullptr;
+                const tx_bound* end_tx = nullptr;
+                if (!m_records.empty()) {
+                    start_bound = get_bound(m_records.front());
+                    start_tx = &start_bound;
+                }
+                if (!txs.empty()) {
+                    end_bound = get_bound(txs.back());
+                    end_tx = &end_bound;
+                }
+                std::tie(page_txs, is_last_page) = fetch_txs(start_tx, end_tx, state_info, get_txs, *m_stats);
 
                 // Add the loaded txs to our collection
                 check_for_duplicates(txs, page_txs, "cache:get newest (inner): Duplicate detected");
                 txs.insert(txs.end(), move_iter(page_txs.begin()), move_iter(page_txs.end()));
-            } while (!is_last_page && m_tx_cache.empty() && txs.size() < required_cache_size);
+            } while (!is_last_page && m_records.empty() && txs.size() < required_cache_size);
+
+            // Check only the txs we have not seen before. Txs fetched again after
+            // being removed below were checked when they were first fetched, and
+            // checking them again would remove their ancestors one at a time.
+            size_t invalidated_count = 0;
+            if (m_is_targeted && m_oldest_mempool_ordinal != NO_ORDINAL) {
+                for (size_t i = num_checked; i < txs.size(); ++i) {
+                    const auto txhash = h2b<32>(json_get_value(txs[i], "txhash"));
+                    if (std::find(removed.begin(), removed.end(), txhash) == removed.end()) {
+                        invalidated_count = std::max(invalidated_count, get_invalidated_count(get_spends(txs[i])));
+                    }
+                }
+            }
+            num_checked = txs.size();
+            if (invalidated_count) {
+                // The new txs spend from or double spend some of our cached txs.
+                // Remove them, then fetch the txs between the new txs and the
+                // remaining cached txs.
+                for (size_t i = 0; i < invalidated_count; ++i) {
+                    removed.push_back(m_records[i].txhash);
+                }
+                remove_invalidated_txs(invalidated_count);
+                continue;
+            }
 
-            if (is_last_page && m_tx_cache.empty()) {
+            if (is_last_page && m_records.empty()) {
                 // We loaded all the users txs while loading the newest ones.
                 // Record the oldest txhash so we know we don't need to load more.
                 m_oldest_txhash = txs.empty() ? "none" : txs.back()["txhash"];
             }
             // Add all loaded txs to the start of the tx cache.
-            check_for_duplicates(m_tx_cache, txs, "cache:get newest (outer): Duplicate detected");
-            m_tx_cache.insert(m_tx_cache.begin(), move_iter(txs.begin()), move_iter(txs.end()));
+            push_front(txs);
 
             // Avoid reloading new txs until we are dirtied again by a new tx/block.
             m_is_front_dirty = false;
         }
+    }
 
-        // At this point, the cache contains the newest txs from the server, followed
-        // by any txs we already had cached.
+    uint32_t tx_list_cache::get_cursor_position(
+        const tx_cursor& cursor, nlohmann::json& state_info, get_txs_fn_t get_txs)
+    {
+        refresh_front(1, state_info, get_txs);
+        if (cursor.txhash.empty()) {
+            return 0; // Start from the newest tx
+        }
+        const auto txhash = h2b<32>(cursor.txhash);
+        for (;;) {
+            const int64_t* ordinal = m_txhash_index.find(txhash);
+            if (ordinal) {
+                return static_cast<uint32_t>(get_position(*ordinal) + 1);
+            }
+            // The cursor tx isn't cached: either we haven't fetched it yet, or
+            // it was removed (e.g. it was replaced). Continue from the first tx
+            // at least as old as it, which may repeat txs with the same timestamp.
+            const auto p = std::partition_point(m_records.begin(), m_records.end(),
+                [&cursor](const tx_record& record) { return record.created_at > cursor.created_at; });
+            if (p != m_records.end() || m_records.empty() || !m_oldest_txhash.empty()) {
+                return static_cast<uint32_t>(std::distance(m_records.begin(), p));
+            }
+            fetch_older(m_records.size() + 1, 1, state_info, get_txs);
+        }
+    }
 
-        if (m_tx_cache.empty()) {
-            // The caller has no txs.
-            return std::make_pair(container_type(), state_info);
+    void tx_list_cache::sync_all(int64_t earliest_time, nlohmann::json& state_info, get_txs_fn_t get_txs,
+        size_t num_helpers, const std::function<void(std::function<void()>)>& post)
+    {
+        refresh_front(1, state_info, get_txs);
+        if (m_records.empty() || !m_oldest_txhash.empty()) {
+            return; // No txs, or we have already fetched them all
         }
 
-        // Load any older txs we need from the server
-        while (m_tx_cache.size() < required_cache_size && m_oldest_txhash.empty()) {
+        // Split the time before the oldest cached tx into windows, newest first.
+        // Txs with the same timestamp as the oldest cached tx are fetched again,
+        // and discarded below.
+        const int64_t end = m_records.back().created_at + 1;
+        const int64_t start = std::min(std::max<int64_t>(earliest_time, 1), end - 1);
+        const size_t num_windows = static_cast<size_t>(std::min<int64_t>(BULK_SYNC_WINDOWS, end - start));
+        const int64_t window_secs = (end - start) / static_cast<int64_t>(num_windows);
+
+        std::vector<container_type> results(num_windows);
+        std::vector<nlohmann::json> window_state_info(num_windows, state_info);
+        GDK_LOG_SEV(cache_log_level) << "sync_all: fetching " << num_windows << " windows";
+        parallel_for(num_windows, num_helpers, post, [&](size_t i) {
+            const int64_t window_end = end - static_cast<int64_t>(i) * window_secs;
+            const int64_t window_start = i + 1 == num_windows ? 0 : window_end - window_secs;
+            results[i] = fetch_window(window_start, window_end, window_state_info[i], get_txs, *m_stats);
+        });
+
+        container_type txs;
+        for (size_t i = 0; i < num_windows; ++i) {
+            merge_state_info(state_info, window_state_info[i]);
+            for (auto& tx : results[i]) {
+                if (!m_txhash_index.find(h2b<32>(json_get_value(tx, "txhash")))) {
+                    txs.emplace_back(std::move(tx));
+                }
+            }
+        }
+        push_back(txs);
+        // Record the oldest txhash so we know we don't need to load more
+        m_oldest_txhash = b2h(m_records.back().txhash);
+        dump_cache(m_records, " after sync_all");
+    }
+
+    tx_list_cache::tx_cursor tx_list_cache::get_cursor(const nlohmann::json& tx)
+    {
+        return { json_get_value(tx, "txhash"), get_created_at(tx) };
+    }
+
+    bool tx_list_cache::prefetch(uint32_t required_cache_size, nlohmann::json& state_info, get_txs_fn_t get_txs)
+    {
+        if (m_is_front_dirty || m_records.empty()) {
+            return false;
+        }
+        fetch_older(required_cache_size, 1, state_info, get_txs);
+        return m_records.size() < required_cache_size && m_oldest_txhash.empty();
+    }
+
+    void tx_list_cache::fetch_older(
+        uint32_t required_cache_size, uint32_t max_pages, nlohmann::json& state_info, get_txs_fn_t get_txs)
+    {
+        container_type page_txs;
+        bool is_last_page;
+        for (uint32_t i = 0; i < max_pages && m_records.size() < required_cache_size && m_oldest_txhash.empty(); ++i) {
             // We need to load more txs from the server to fulfill the callers
             // request, and we have more txs available to fetch.
-            const value_type* end_tx = &m_tx_cache.back();
-            std::tie(page_txs, is_last_page) = fetch_txs(nullptr, end_tx, state_info, get_txs);
+            const tx_bound end_tx = get_bound(m_records.back());
+            std::tie(page_txs, is_last_page) = fetch_txs(nullptr, &end_tx, state_info, get_txs, *m_stats);
 
             // Add the loaded txs to the end of the tx cache.
-            check_for_duplicates(m_tx_cache, page_txs, "cache:get oldest: Duplicate detected");
-            m_tx_cache.insert(m_tx_cache.end(), move_iter(page_txs.begin()), move_iter(page_txs.end()));
+            push_back(page_txs);
 
             if (is_last_page) {
                 // We have loaded all txs from the server.
                 // Record the oldest txhash so we know we don't need to load more.
-                m_oldest_txhash = m_tx_cache.back()["txhash"];
+                m_oldest_txhash = b2h(m_records.back().txhash);
             }
         }
-
-        if (first >= m_tx_cache.size()) {
-            // Caller is asking for txs beyond the cache size.
-            return std::make_pair(container_type(), state_info);
-        }
-
-        // return results from the cached txs
-        const auto start = m_tx_cache.begin() + first;
-        const size_t remaining = std::distance(start, m_tx_cache.end());
-        const auto finish = start + std::min<size_t>(count, remaining);
-
-        dump_cache(m_tx_cache, " after get");
-        return std::make_pair(container_type{ start, finish }, state_info);
     }
 
     void tx_list_cache::on_new_block(uint32_t ga_block_height, const nlohmann::json& details)
@@ -283,9 +549,9 @@ namespace sdk {
         if (diverged) {
             GDK_LOG_SEV(log_level::info) << "chain reorg detected, clearing cache...";
             // TODO: Delete only outdated blocks
-            m_tx_cache.clear();
+            clear();
             m_is_front_dirty = true;
-            m_oldest_txhash.clear();
+            on_front_erased();
         } else {
             remove_mempool_txs();
         }
@@ -293,19 +559,26 @@ namespace sdk {
 
     void tx_list_cache::on_new_transaction(const nlohmann::json& details)
     {
-        auto p = find_last_of(
-            m_tx_cache, [&details](const auto& tx) -> bool { return tx["txhash"] == details["txhash"]; });
-        if (p != m_tx_cache.end() && json_get_value((*p), "block_height", 0) != 0) {
+        const auto txhash = h2b<32>(details.at("txhash").get<std::string>());
+        const int64_t* ordinal = m_txhash_index.find(txhash);
+        const uint32_t block_height = ordinal ? m_records[get_position(*ordinal)].block_height : 0;
+        if (block_height != 0) {
             // We have been notified of a confirmed tx we already had cached as confirmed.
             // Either the tx was reorged or the server is re-processing txs; either way
             // remove all cached txs from the block the tx was originally in onwards, along
             // with any mempool txs.
-            remove_forked_txs(json_get_value((*p), "block_height", 0));
-        } else {
+            remove_forked_txs(block_height);
+        } else if (!m_is_targeted) {
             // We havent seen this tx yet, or we've been re-notified of a mempool tx.
             // Remove any mempool txs this tx could be double spending/replacing
             remove_mempool_txs();
+        } else if (ordinal) {
+            // We've been re-notified of a mempool tx, which has confirmed or been
+            // replaced. Remove it along with any mempool txs it spends or conflicts with.
+            const auto& spends = m_mempool_spends.at(*ordinal);
+            remove_invalidated_txs(std::max(get_position(*ordinal) + 1, get_invalidated_count(spends)));
         }
+        // Otherwise this is a new tx; we check what it invalidates when we fetch it
         // Whether we removed any cached txs or not, there is a new tx we don't have,
         // so the front of the cache needs refreshing
         m_is_front_dirty = true;
@@ -314,61 +587,355 @@ namespace sdk {
     void tx_list_cache::remove_mempool_txs()
     {
         GDK_LOG_SEV(cache_log_level) << "remove_mempool_txs";
-        dump_cache(m_tx_cache, "before remove_mempool_txs");
-        auto p = find_last_of(
-            m_tx_cache, [](const auto& tx) -> bool { return json_get_value(tx, "block_height", 0) == 0; });
-        if (p != m_tx_cache.end()) {
-            m_tx_cache.erase(m_tx_cache.begin(), std::next(p));
+        dump_cache(m_records, "before remove_mempool_txs");
+        if (m_oldest_mempool_ordinal != NO_ORDINAL) {
+            erase_front(get_position(m_oldest_mempool_ordinal) + 1);
             // We removed some tx, so the front of the cache needs refreshing
             m_is_front_dirty = true;
         }
-        if (m_tx_cache.empty()) {
+        on_front_erased();
+        dump_cache(m_records, "after remove_mempool_txs");
+    }
+
+    void tx_list_cache::remove_forked_txs(uint32_t block_height)
+    {
+        GDK_LOG_SEV(cache_log_level) << "remove_forked_txs";
+        dump_cache(m_records, "before remove_forked_txs");
+        // Txs are in timestamp rather than block order, so any cached tx may
+        // be from the forked block. All mempool txs are removed along with them.
+        size_t count = m_oldest_mempool_ordinal == NO_ORDINAL ? 0 : get_position(m_oldest_mempool_ordinal) + 1;
+        for (size_t i = count; i < m_records.size(); ++i) {
+            if (m_records[i].block_height >= block_height) {
+                count = i + 1;
+            }
+        }
+        erase_front(count);
+        on_front_erased();
+        dump_cache(m_records, "after remove_forked_txs");
+    }
+
+    void tx_list_cache::remove_invalidated_txs(size_t count)
+    {
+        GDK_LOG_SEV(cache_log_level) << "remove_invalidated_txs: " << count;
+        dump_cache(m_records, "before remove_invalidated_txs");
+        erase_front(count);
+        m_is_front_dirty = true;
+        on_front_erased();
+        dump_cache(m_records, "after remove_invalidated_txs");
+    }
+
+    std::vector<tx_list_cache::outpoint_t> tx_list_cache::get_spends(const nlohmann::json& tx) const
+    {
+        // Only unconfirmed txs are returned with their tx hex
+        std::vector<outpoint_t> spends;
+        const std::string tx_data = json_get_value(tx, "data");
+        if (tx_data.empty()) {
+            return spends;
+        }
+        try {
+            const auto wally_tx = tx_from_hex(tx_data, tx_flags(m_is_liquid));
+            spends.resize(wally_tx->num_inputs);
+            for (size_t i = 0; i < wally_tx->num_inputs; ++i) {
+                const auto& input = wally_tx->inputs[i];
+                std::reverse_copy(input.txhash, input.txhash + spends[i].first.size(), spends[i].first.begin());
+                spends[i].second = input.index;
+            }
+        } catch (const std::exception& e) {
+            const std::string txhash = json_get_value(tx, "txhash");
+            GDK_LOG_SEV(log_level::warning) << "Failed to parse tx " << txhash << ": " << e.what();
+            spends.clear();
+        }
+        return spends;
+    }
+
+    size_t tx_list_cache::get_invalidated_count(const std::vector<outpoint_t>& spends) const
+    {
+        // Returns the number of txs from the front of the cache to remove so that
+        // every mempool tx spent or double spent by a tx spending 'spends' is removed
+        if (spends.empty()) {
+            // Unknown spends: the tx may double spend any mempool tx
+            return m_oldest_mempool_ordinal == NO_ORDINAL ? 0 : get_position(m_oldest_mempool_ordinal) + 1;
+        }
+        size_t count = 0;
+        for (const auto& mempool_tx : m_mempool_spends) {
+            const size_t position = get_position(mempool_tx.first);
+            if (position < count) {
+                continue; // Already being removed
+            }
+            const auto& txhash = m_records[position].txhash;
+            const auto& tx_spends = mempool_tx.second;
+            const bool is_invalidated = tx_spends.empty()
+                || std::any_of(spends.begin(), spends.end(), [&txhash, &tx_spends](const outpoint_t& spend) {
+                       return spend.first == txhash
+                           || std::find(tx_spends.begin(), tx_spends.end(), spend) != tx_spends.end();
+                   });
+            if (is_invalidated) {
+                count = position + 1;
+            }
+        }
+        return count;
+    }
+
+    void tx_list_cache::on_front_erased()
+    {
+        if (m_records.empty()) {
             // We removed all cached txs or had none cached, so we don't know
             // the txhash of the last item the server would return yet.
             m_oldest_txhash.clear();
+            // Start numbering again from scratch; all persisted txs are invalid
+            m_back_ordinal = 0;
+            m_persisted_min = 0;
+            m_persisted_max = -1;
+            return;
         }
-        dump_cache(m_tx_cache, "after remove_mempool_txs");
+        // Newer txs may be inserted at the ordinals of the erased txs
+        m_persisted_max = std::min(m_persisted_max, get_front_ordinal());
     }
 
-    void tx_list_cache::remove_forked_txs(uint32_t block_height)
+    gsl::span<const unsigned char> tx_list_cache::get_encoded_tx(const tx_record& record) const
     {
-        GDK_LOG_SEV(cache_log_level) << "remove_forked_txs";
-        dump_cache(m_tx_cache, "before remove_forked_txs");
-        auto p = find_last_of(m_tx_cache, [block_height](const auto& tx) -> bool {
-            const uint32_t bh = json_get_value(tx, "block_height", 0);
-            return bh == 0 || bh >= block_height;
-        });
-        if (p != m_tx_cache.end()) {
-            m_tx_cache.erase(m_tx_cache.begin(), std::next(p));
+        return gsl::make_span(m_arena).subspan(record.offset, record.length);
+    }
+
+    tx_list_cache::tx_record tx_list_cache::make_record(const nlohmann::json& tx)
+    {
+        tx_record record;
+        record.txhash = h2b<32>(tx.at("txhash").get<std::string>());
+        record.block_height = json_get_value(tx, "block_height", 0u);
+        record.created_at = get_created_at(tx);
+        const size_t offset = m_arena.size();
+        nlohmann::json::to_msgpack(tx, m_arena); // Appends to the arena
+        GDK_RUNTIME_ASSERT(m_arena.size() <= std::numeric_limits<uint32_t>::max());
+        record.offset = static_cast<uint32_t>(offset);
+        record.length = static_cast<uint32_t>(m_arena.size() - offset);
+        m_arena_used += record.length;
+        return record;
+    }
+
+    void tx_list_cache::add_to_index(const nlohmann::json& tx, const tx_record& record, int64_t ordinal)
+    {
+        GDK_RUNTIME_ASSERT_MSG(m_txhash_index.insert(record.txhash, ordinal), "Duplicate tx detected");
+        if (!record.block_height) {
+            m_oldest_mempool_ordinal = std::min(m_oldest_mempool_ordinal, ordinal);
+            if (m_is_targeted) {
+                m_mempool_spends.emplace(ordinal, get_spends(tx));
+            }
+        }
+    }
+
+    void tx_list_cache::push_front(const container_type& txs)
+    {
+        std::vector<tx_record> records;
+        records.reserve(txs.size());
+        for (const auto& tx : txs) {
+            records.emplace_back(make_record(tx));
+        }
+        // The newest tx added takes the highest ordinal
+        int64_t ordinal = get_front_ordinal() + static_cast<int64_t>(records.size());
+        for (size_t i = 0; i < records.size(); ++i) {
+            add_to_index(txs[i], records[i], ordinal--);
+        }
+        m_records.insert(m_records.begin(), records.begin(), records.end());
+    }
+
+    void tx_list_cache::push_back(const container_type& txs)
+    {
+        for (const auto& tx : txs) {
+            m_records.emplace_back(make_record(tx));
+            add_to_index(tx, m_records.back(), --m_back_ordinal);
         }
-        dump_cache(m_tx_cache, "after remove_forked_txs");
     }
 
-    void tx_list_caches::purge_all() { m_caches.clear(); }
+    void tx_list_cache::erase_front(size_t count)
+    {
+        GDK_RUNTIME_ASSERT(count <= m_records.size());
+        if (count == m_records.size()) {
+            clear();
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            m_txhash_index.erase(m_records.front().txhash);
+            m_arena_used -= m_records.front().length;
+            m_records.pop_front();
+        }
+        m_stats->evicted_txs += count;
+        m_mempool_spends.erase(m_mempool_spends.upper_bound(get_front_ordinal()), m_mempool_spends.end());
+        if (m_oldest_mempool_ordinal > get_front_ordinal()) {
+            // All mempool txs were erased
+            m_oldest_mempool_ordinal = NO_ORDINAL;
+        }
+        if (m_arena.size() - m_arena_used >= std::max(m_arena_used, MIN_ARENA_COMPACT_BYTES)) {
+            compact_arena();
+        }
+    }
 
-    void tx_list_caches::purge(uint32_t subaccount) { m_caches.erase(subaccount); }
+    void tx_list_cache::clear()
+    {
+        m_stats->evicted_txs += m_records.size();
+        m_records.clear();
+        std::vector<unsigned char>().swap(m_arena);
+        m_arena_used = 0;
+        m_txhash_index.clear();
+        m_oldest_mempool_ordinal = NO_ORDINAL;
+        m_mempool_spends.clear();
+    }
+
+    void tx_list_cache::compact_arena()
+    {
+        std::vector<unsigned char> arena;
+        arena.reserve(m_arena_used);
+        for (auto& record : m_records) {
+            const auto tx = get_encoded_tx(record);
+            record.offset = static_cast<uint32_t>(arena.size());
+            arena.insert(arena.end(), tx.begin(), tx.end());
+        }
+        m_arena.swap(arena);
+    }
+
+    void tx_list_cache::load(
+        container_type txs, int64_t back_ordinal, const std::string& oldest_txhash, uint32_t block_height)
+    {
+        GDK_RUNTIME_ASSERT(!m_is_loaded && m_records.empty());
+        m_is_loaded = true;
+        if (txs.empty()) {
+            return;
+        }
+        m_back_ordinal = back_ordinal;
+        push_front(txs);
+        m_persisted_min = back_ordinal;
+        m_persisted_max = get_front_ordinal();
+        if (!oldest_txhash.empty() && json_get_value(txs.back(), "txhash") == oldest_txhash) {
+            m_oldest_txhash = oldest_txhash;
+            m_persisted_oldest_txhash = oldest_txhash;
+        }
+        GDK_LOG_SEV(cache_log_level) << "loaded " << m_records.size() << " persisted txs";
+        // We may have missed a reorg while logged out
+        remove_forked_txs(block_height);
+        m_is_front_dirty = true;
+    }
+
+    bool tx_list_cache::get_changes(tx_list_changes& changes)
+    {
+        // Only confirmed txs older than any mempool tx are persisted, since
+        // any txs newer than a mempool tx are removed along with it
+        const int64_t min_ordinal = m_back_ordinal;
+        const int64_t max_ordinal
+            = m_oldest_mempool_ordinal == NO_ORDINAL ? get_front_ordinal() : m_oldest_mempool_ordinal - 1;
+
+        changes.keep_min = std::max(m_persisted_min, min_ordinal);
+        changes.keep_max = std::min(m_persisted_max, max_ordinal);
+        changes.txs.clear();
+        // Only txs outside the kept range need writing, and those are at either end
+        for (int64_t ordinal = max_ordinal; ordinal >= min_ordinal; --ordinal) {
+            if (ordinal <= changes.keep_max && ordinal >= changes.keep_min) {
+                ordinal = changes.keep_min; // Skip the kept range
+                continue;
+            }
+            const auto tx = get_encoded_tx(m_records[get_position(ordinal)]);
+            changes.txs.emplace_back(ordinal, std::vector<unsigned char>(tx.begin(), tx.end()));
+        }
+        const bool is_complete = !m_oldest_txhash.empty() && m_oldest_txhash != "none";
+        changes.oldest_txhash = is_complete && min_ordinal <= max_ordinal ? m_oldest_txhash : std::string();
+
+        const auto is_same_range = [](int64_t min_a, int64_t max_a, int64_t min_b, int64_t max_b) {
+            return (min_a > max_a && min_b > max_b) || (min_a == min_b && max_a == max_b);
+        };
+        const bool changed = !changes.txs.empty()
+            || !is_same_range(changes.keep_min, changes.keep_max, m_persisted_min, m_persisted_max)
+            || changes.oldest_txhash != m_persisted_oldest_txhash;
+        m_persisted_min = min_ordinal;
+        m_persisted_max = max_ordinal;
+        m_persisted_oldest_txhash = changes.oldest_txhash;
+        return changed;
+    }
+
+    tx_list_caches::tx_list_caches(bool is_liquid, bool is_targeted)
+        : m_is_liquid(is_liquid)
+        , m_is_targeted(is_targeted)
+        , m_stats(std::make_shared<tx_list_stats>())
+    {
+    }
+
+    void tx_list_caches::purge_all()
+    {
+        m_caches.clear();
+        m_pending.clear();
+        ++m_generation;
+    }
+
+    void tx_list_caches::purge(uint32_t subaccount)
+    {
+        m_caches.erase(subaccount);
+        m_pending.erase(subaccount);
+        ++m_generation;
+    }
 
     std::shared_ptr<tx_list_cache> tx_list_caches::get(uint32_t subaccount)
     {
         std::shared_ptr<tx_list_cache>& cache = m_caches[subaccount];
         if (cache.get() == nullptr) {
-            cache.reset(new tx_list_cache());
+            cache.reset(new tx_list_cache(m_is_liquid, m_is_targeted, m_stats));
         }
         return cache;
     }
 
+    bool tx_list_caches::is_current(uint32_t subaccount, const std::shared_ptr<tx_list_cache>& cache) const
+    {
+        const auto p = m_caches.find(subaccount);
+        return p != m_caches.end() && p->second == cache;
+    }
+
     void tx_list_caches::on_new_block(uint32_t ga_block_height, const nlohmann::json& details)
     {
         GDK_LOG_SEV(cache_log_level) << "on_new_block:" << details.dump();
+        ++m_generation;
         for (auto& cache : m_caches) {
-            cache.second->on_new_block(ga_block_height, details);
+            update(cache.first, cache.second,
+                [ga_block_height, details](tx_list_cache& c) { c.on_new_block(ga_block_height, details); });
         }
     }
 
     void tx_list_caches::on_new_transaction(uint32_t subaccount, const nlohmann::json& details)
     {
         GDK_LOG_SEV(cache_log_level) << "on_new_transaction:" << details.dump();
-        get(subaccount)->on_new_transaction(details);
+        ++m_generation;
+        ++m_stats->notifications;
+        update(subaccount, get(subaccount), [details](tx_list_cache& c) { c.on_new_transaction(details); });
+    }
+
+    void tx_list_caches::apply_pending(uint32_t subaccount, tx_list_cache& cache)
+    {
+        const auto p = m_pending.find(subaccount);
+        if (p != m_pending.end()) {
+            GDK_LOG_SEV(cache_log_level) << "applying " << p->second.size() << " queued notifications";
+            for (const auto& fn : p->second) {
+                fn(cache);
+            }
+            m_pending.erase(p);
+        }
+    }
+
+    void tx_list_caches::update(uint32_t subaccount, const std::shared_ptr<tx_list_cache>& cache, update_fn_t fn)
+    {
+        // Never wait for the cache here: its user may be waiting for the session mutex
+        std::unique_lock<std::mutex> cache_locker(cache->get_mutex(), std::try_to_lock);
+        if (!cache_locker.owns_lock()) {
+            m_pending[subaccount].emplace_back(std::move(fn));
+            return;
+        }
+        apply_pending(subaccount, *cache);
+        fn(*cache);
+    }
+
+    void tx_list_caches::for_each(const std::function<void(uint32_t, tx_list_cache&)>& fn)
+    {
+        for (auto& cache : m_caches) {
+            std::unique_lock<std::mutex> cache_locker(cache.second->get_mutex(), std::try_to_lock);
+            if (cache_locker.owns_lock()) {
+                apply_pending(cache.first, *cache.second);
+                fn(cache.first, *cache.second);
+            }
+        }
     }
 
 } // namespace sdk
@@ -2,24 +2,83 @@
 #define GDK_TX_LIST_CACHE_HPP
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <deque>
 #include <functional>
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
+#include "containers.hpp"
+
 namespace ga {
 namespace sdk {
+    // Changes to the persisted copy of a tx_list_cache. Persisted txs are
+    // identified by ordinal, with the oldest tx having the lowest ordinal.
+    struct tx_list_changes {
+        int64_t keep_min; // Persisted txs outside [keep_min, keep_max] must be removed
+        int64_t keep_max;
+        std::vector<std::pair<int64_t, std::vector<unsigned char>>> txs; // msgpack encoded txs to write
+        std::string oldest_txhash; // Set if the oldest persisted tx is the oldest tx on the server
+    };
+
+    // Counters describing how much tx list data is invalidated and refetched.
+    // Shared by the caches of every subaccount, which may update them concurrently
+    struct tx_list_stats {
+        std::atomic<uint64_t> notifications{ 0 }; // New tx notifications handled
+        std::atomic<uint64_t> evicted_txs{ 0 }; // Cached txs removed
+        std::atomic<uint64_t> fetched_txs{ 0 }; // Txs fetched from the server
+        std::atomic<uint64_t> server_calls{ 0 }; // Pages requested from the server
+        nlohmann::json to_json() const;
+    };
+
     class tx_list_cache {
     public:
+        // The number of blocks to discard from persisted txs on loading, to
+        // allow for reorgs that happened while we were logged out
+        static constexpr uint32_t REORG_BLOCKS = 6;
+        // The maximum number of server pages to prefetch after a call to get
+        static constexpr uint32_t MAX_PREFETCH_PAGES = 4;
+        // The number of date ranges the history is split into by 'sync_all'
+        static constexpr uint32_t BULK_SYNC_WINDOWS = 16;
+
+        // A cached tx. The tx itself is held msgpack encoded in an arena,
+        // with the fields used to maintain the cache stored alongside it
+        struct tx_record {
+            std::array<unsigned char, 32> txhash;
+            uint32_t block_height; // 0 for mempool txs
+            int64_t created_at; // Seconds since the epoch
+            uint32_t offset; // Location of the encoded tx in the arena
+            uint32_t length;
+        };
+
         using container_type = std::deque<nlohmann::json>;
         using iterator = container_type::iterator;
         using get_txs_fn_t
             = std::function<container_type(uint32_t, const std::string&, const std::string&, nlohmann::json&)>;
         using get_fn_ret_t = std::pair<container_type, nlohmann::json>;
+        // A position in the tx list, following the given tx. The timestamp
+        // allows the position to be found if the tx is no longer present.
+        struct tx_cursor {
+            std::string txhash; // Empty for the start of the list
+            int64_t created_at;
+        };
+        // A tx output, with the txhash in display (reversed) order
+        using outpoint_t = std::pair<std::array<unsigned char, 32>, uint32_t>;
+
+        // If 'is_targeted' is true, tx notifications only remove the cached txs
+        // they spend or replace, rather than every mempool tx
+        tx_list_cache(bool is_liquid, bool is_targeted, std::shared_ptr<tx_list_stats> stats);
+
+        // The caller must hold this mutex while using the cache. Other
+        // subaccounts' caches can be used concurrently.
+        std::mutex& get_mutex() { return m_mutex; }
 
         // Get an item from the cache, using 'get_txs' to fetch missing entries.
         // Note that 'get_txs' must not lock the mutex on ga_session.
@@ -28,26 +87,114 @@ namespace sdk {
         void on_new_block(uint32_t ga_block_height, const nlohmann::json& details);
         void on_new_transaction(const nlohmann::json& details);
 
+        // Get the position of the tx following 'cursor', fetching the newest
+        // txs and any older txs up to the cursor tx as needed
+        uint32_t get_cursor_position(const tx_cursor& cursor, nlohmann::json& state_info, get_txs_fn_t get_txs);
+        // Get a cursor for the position following the given tx
+        static tx_cursor get_cursor(const nlohmann::json& tx);
+
+        // Fetch the entire tx history, requesting txs older than those cached
+        // in BULK_SYNC_WINDOWS date ranges from 'earliest_time' onwards. The ranges
+        // are fetched concurrently by the caller and up to 'num_helpers' tasks
+        // submitted with 'post', so 'get_txs' must be thread safe.
+        void sync_all(int64_t earliest_time, nlohmann::json& state_info, get_txs_fn_t get_txs, size_t num_helpers,
+            const std::function<void(std::function<void()>)>& post);
+
+        // Fetch one page of older txs if fewer than 'required_cache_size' are
+        // cached. Newer txs are only fetched by 'get', so nothing is fetched if
+        // the front of the cache is dirty. Returns true if more txs are required.
+        bool prefetch(uint32_t required_cache_size, nlohmann::json& state_info, get_txs_fn_t get_txs);
+
+        // Whether persisted txs have been loaded into the cache
+        bool is_loaded() const { return m_is_loaded; }
+        // Load persisted txs, newest first, where the oldest has ordinal 'back_ordinal'.
+        // Txs from 'block_height' onwards are discarded as they may have been reorged.
+        void load(container_type txs, int64_t back_ordinal, const std::string& oldest_txhash, uint32_t block_height);
+        // Get the changes to persist since the last call. Returns false if there are none.
+        bool get_changes(tx_list_changes& changes);
+
     private:
+        static constexpr int64_t NO_ORDINAL = std::numeric_limits<int64_t>::max();
+
+        std::vector<outpoint_t> get_spends(const nlohmann::json& tx) const;
+        size_t get_invalidated_count(const std::vector<outpoint_t>& spends) const;
+        void refresh_front(uint32_t required_cache_size, nlohmann::json& state_info, get_txs_fn_t get_txs);
+        void fetch_older(
+            uint32_t required_cache_size, uint32_t max_pages, nlohmann::json& state_info, get_txs_fn_t get_txs);
         void remove_mempool_txs();
         void remove_forked_txs(uint32_t block_height);
+        void remove_invalidated_txs(size_t count);
+        void on_front_erased();
+
+        int64_t get_front_ordinal() const { return m_back_ordinal + static_cast<int64_t>(m_records.size()) - 1; }
+        size_t get_position(int64_t ordinal) const { return static_cast<size_t>(get_front_ordinal() - ordinal); }
+        gsl::span<const unsigned char> get_encoded_tx(const tx_record& record) const;
+        tx_record make_record(const nlohmann::json& tx);
+        // Add newer txs to the front or older txs to the back, newest first
+        void push_front(const container_type& txs);
+        void push_back(const container_type& txs);
+        void add_to_index(const nlohmann::json& tx, const tx_record& record, int64_t ordinal);
+        void erase_front(size_t count);
+        void clear();
+        void compact_arena();
 
+        std::mutex m_mutex;
+        const bool m_is_liquid;
+        const bool m_is_targeted;
+        std::shared_ptr<tx_list_stats> m_stats;
         bool m_is_front_dirty = true; // Whether we need to fetch the newest txs from the server
         std::string m_oldest_txhash; // The txhash of the final server result, once returned
-        container_type m_tx_cache;
+        std::deque<tx_record> m_records; // Newest first
+        std::vector<unsigned char> m_arena; // Encoded txs
+        size_t m_arena_used = 0; // Bytes of m_arena used by cached txs
+        open_hash_map<int64_t> m_txhash_index; // txhash to ordinal
+        int64_t m_oldest_mempool_ordinal = NO_ORDINAL; // Lowest ordinal of any mempool tx
+        std::map<int64_t, std::vector<outpoint_t>> m_mempool_spends; // Outputs spent by each mempool tx, by ordinal
+        bool m_is_loaded = false;
+        int64_t m_back_ordinal = 0; // Ordinal of the oldest cached tx
+        int64_t m_persisted_min = 0; // Range of persisted ordinals, empty if min > max
+        int64_t m_persisted_max = -1;
+        std::string m_persisted_oldest_txhash;
     };
 
+    // The tx list caches for each subaccount. Callers must hold the session
+    // mutex, and must not wait for a cache mutex while holding it.
     class tx_list_caches {
     public:
+        tx_list_caches(bool is_liquid, bool is_targeted);
+
         void purge_all();
         void purge(uint32_t subaccount);
         std::shared_ptr<tx_list_cache> get(uint32_t subaccount);
+        // Whether 'cache' is still the cache for 'subaccount', i.e. it has not been purged
+        bool is_current(uint32_t subaccount, const std::shared_ptr<tx_list_cache>& cache) const;
 
+        // Notifications are applied immediately to caches that are not in use,
+        // and are otherwise queued until the user of the cache calls 'apply_pending'
         void on_new_block(uint32_t ga_block_height, const nlohmann::json& details);
         void on_new_transaction(uint32_t subaccount, const nlohmann::json& details);
+        // Apply any queued notifications. The caller must hold the cache mutex
+        void apply_pending(uint32_t subaccount, tx_list_cache& cache);
+
+        // Call 'fn' for every cache that is not currently in use
+        void for_each(const std::function<void(uint32_t, tx_list_cache&)>& fn);
+
+        // Changes whenever cached txs may have become invalid, so that
+        // background work started before then can be abandoned
+        uint64_t get_generation() const { return m_generation; }
+
+        nlohmann::json get_stats() const { return m_stats->to_json(); }
 
     private:
+        using update_fn_t = std::function<void(tx_list_cache&)>;
+        void update(uint32_t subaccount, const std::shared_ptr<tx_list_cache>& cache, update_fn_t fn);
+
+        const bool m_is_liquid;
+        const bool m_is_targeted;
+        std::shared_ptr<tx_list_stats> m_stats;
         std::map<uint32_t, std::shared_ptr<tx_list_cache>> m_caches;
+        std::map<uint32_t, std::vector<update_fn_t>> m_pending; // Notifications for caches in use
+        uint64_t m_generation = 0;
     };
 
 } // namespace sdk
@@ -0,0 +1,406 @@
+#include "src/ga_cache.hpp"
+#include "src/network_parameters.hpp"
+#include "src/ga_wally.hpp"
+#include "src/memory.hpp"
+#include "src/session.hpp"
+#include "src/sqlite3/sqlite3.h"
+#include "src/transaction_utils.hpp"
+#include "src/utils.hpp"
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+using namespace ga::sdk;
+
+// Verify the cache database persists and reloads correctly
+
+namespace {
+constexpr uint32_t NUM_OUTPUTS = 1000;
+constexpr uint32_t MAX_LIQUID_ROWS = NUM_OUTPUTS * 4;
+
+std::vector<unsigned char> get_txhash(uint32_t i)
+{
+    std::vector<unsigned char> txhash(32, 0xff);
+    txhash[0] = i & 0xff;
+    txhash[1] = i >> 8;
+    return txhash;
+}
+
+nlohmann::json get_utxo(uint32_t i)
+{
+    const std::string blinder(64, "0123456789abcdef"[i % 16]);
+    return { { "asset_id", blinder }, { "satoshi", i }, { "assetblinder", blinder }, { "amountblinder", blinder } };
+}
+
+void insert_outputs(cache& c, uint32_t start, uint32_t end)
+{
+    for (uint32_t i = start; i < end; ++i) {
+        auto utxo = get_utxo(i);
+        c.insert_liquid_output(get_txhash(i), i, utxo);
+    }
+}
+
+void insert_outputs_bulk(cache& c, uint32_t start, uint32_t end)
+{
+    std::vector<cache::liquid_output_t> outputs;
+    for (uint32_t i = start; i < end; ++i) {
+        outputs.push_back({ get_txhash(i), i, get_utxo(i) });
+    }
+    GDK_RUNTIME_ASSERT(c.insert_liquid_outputs(outputs) == end - start);
+    // Re-inserting existing outputs adds nothing
+    GDK_RUNTIME_ASSERT(c.insert_liquid_outputs(outputs) == 0);
+}
+
+// Get the path of a database file, named as cache::load_db names it
+std::string get_db_path(byte_span_t key, uint32_t type, int version)
+{
+    const auto intermediate = hmac_sha512(key, ustring_span("liquid"));
+    const auto type_span = gsl::make_span(reinterpret_cast<const unsigned char*>(&type), sizeof(type));
+    const auto db_name = b2h(gsl::make_span(hmac_sha512(intermediate, type_span).data(), 16));
+    return "./" + std::to_string(version) + db_name + ".sqliteaesgcm";
+}
+
+bool file_exists(const std::string& path) { return std::ifstream(path).is_open(); }
+
+void check_outputs(cache& c, uint32_t end, uint32_t start = 0)
+{
+    for (uint32_t i = start; i < end; ++i) {
+        const auto utxo = c.get_liquid_output(get_txhash(i), i);
+        GDK_RUNTIME_ASSERT(utxo && *utxo == get_utxo(i));
+    }
+    GDK_RUNTIME_ASSERT(!c.get_liquid_output(get_txhash(end), end));
+}
+} // namespace
+
+int main()
+{
+    nlohmann::json init_config;
+    init_config["datadir"] = ".";
+    init_config["cache_max_liquid_rows"] = MAX_LIQUID_ROWS;
+    init(init_config);
+
+    const network_parameters net_params{ network_parameters::get("liquid") };
+    const auto key = get_random_bytes<32>();
+
+    {
+        // Save a full copy, then changes only
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        insert_outputs(c, 0, NUM_OUTPUTS);
+        c.save_db();
+        insert_outputs(c, NUM_OUTPUTS, NUM_OUTPUTS + 10);
+        c.save_db();
+        // Saves are written in the background; wait for them to complete
+        c.flush();
+        const auto stats = c.get_stats();
+        const auto& writes = stats["writes"];
+        GDK_RUNTIME_ASSERT(writes["pending_writes"] == 0 && writes["writes"] > 0);
+        GDK_RUNTIME_ASSERT(writes["latency"]["count"] == writes["writes"]);
+        GDK_RUNTIME_ASSERT(stats["tables"]["liquid_outputs"]["inserts"] == NUM_OUTPUTS + 10);
+    }
+    {
+        // Reload and save more changes on top of the loaded copy
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        check_outputs(c, NUM_OUTPUTS + 10);
+        const auto stats = c.get_stats();
+        const auto& outputs = stats["tables"]["liquid_outputs"];
+        GDK_RUNTIME_ASSERT(outputs["hits"] == NUM_OUTPUTS + 10 && outputs["misses"] == 1);
+        GDK_RUNTIME_ASSERT(stats["loads"]["count"] == 1);
+        insert_outputs(c, NUM_OUTPUTS + 10, NUM_OUTPUTS + 20);
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        check_outputs(c, NUM_OUTPUTS + 20);
+        insert_outputs_bulk(c, NUM_OUTPUTS + 20, NUM_OUTPUTS * 2);
+
+        std::vector<cache::liquid_blinding_nonce_t> nonces;
+        for (uint32_t i = 0; i < NUM_OUTPUTS; ++i) {
+            nonces.push_back({ get_txhash(i), get_txhash(i + 1), get_txhash(i + 2) });
+        }
+        GDK_RUNTIME_ASSERT(c.insert_liquid_blinding_nonces(nonces) == NUM_OUTPUTS);
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        check_outputs(c, NUM_OUTPUTS * 2);
+        const auto nonce = c.get_liquid_blinding_nonce(get_txhash(5), get_txhash(6));
+        GDK_RUNTIME_ASSERT(nonce && *nonce == get_txhash(7));
+
+        // Evict half of the outputs along with their nonces
+        std::vector<cache::liquid_output_ref_t> spent;
+        for (uint32_t i = 0; i < NUM_OUTPUTS; ++i) {
+            spent.push_back({ get_txhash(i), i, get_txhash(i), get_txhash(i + 1) });
+        }
+        GDK_RUNTIME_ASSERT(c.evict_spent_liquid_outputs(spent) == NUM_OUTPUTS);
+        GDK_RUNTIME_ASSERT(c.evict_spent_liquid_outputs(spent) == 0);
+        const auto stats = c.get_stats()["eviction"];
+        GDK_RUNTIME_ASSERT(stats["evicted_outputs"] == NUM_OUTPUTS && stats["evicted_nonces"] == NUM_OUTPUTS);
+        GDK_RUNTIME_ASSERT(stats["evicted_unblind_failures"] == 0);
+        GDK_RUNTIME_ASSERT(stats["vacuums"] == 1 && stats["vacuumed_bytes"] > 0);
+        GDK_RUNTIME_ASSERT(!c.has_liquid_output(get_txhash(0), 0));
+        GDK_RUNTIME_ASSERT(!c.has_liquid_blinding_nonce(get_txhash(5), get_txhash(6)));
+        check_outputs(c, NUM_OUTPUTS * 2, NUM_OUTPUTS);
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        GDK_RUNTIME_ASSERT(!c.has_liquid_output(get_txhash(NUM_OUTPUTS - 1), NUM_OUTPUTS - 1));
+        check_outputs(c, NUM_OUTPUTS * 2, NUM_OUTPUTS);
+
+        // Persist a tx list, then replace its newest txs
+        std::vector<cache::tx_list_row_t> txs;
+        for (int64_t i = 0; i < 10; ++i) {
+            txs.emplace_back(i, nlohmann::json::to_msgpack(get_utxo(i)));
+        }
+        c.update_tx_list(1, 0, -1, txs, "oldest");
+        txs.erase(txs.begin(), txs.begin() + 8);
+        txs[0].second = nlohmann::json::to_msgpack(get_utxo(100));
+        c.update_tx_list(1, 0, 7, txs, std::string());
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        int64_t expected = 9;
+        const auto oldest_txhash = c.get_tx_list(1, [&expected](int64_t ordinal, byte_span_t tx) {
+            GDK_RUNTIME_ASSERT(ordinal == expected);
+            const auto utxo = nlohmann::json::from_msgpack(tx.begin(), tx.end());
+            GDK_RUNTIME_ASSERT(utxo == get_utxo(ordinal == 8 ? 100 : ordinal));
+            --expected;
+        });
+        GDK_RUNTIME_ASSERT(expected == -1 && oldest_txhash.empty());
+        c.get_tx_list(0, [](int64_t, byte_span_t) { GDK_RUNTIME_ASSERT(false); });
+
+        // Store registry entries, then replace them with a smaller set
+        std::vector<cache::registry_entry_t> entries;
+        for (uint32_t i = 0; i < 10; ++i) {
+            entries.emplace_back(std::to_string(i), nlohmann::json::to_msgpack(get_utxo(i)));
+        }
+        c.replace_registry("index", entries);
+        entries.resize(5);
+        c.replace_registry("index", entries);
+        c.replace_registry("icons", gsl::make_span(entries).subspan(0, 1));
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        size_t count = 0;
+        c.get_registry("index", {}, [&count](const std::string& asset_id, byte_span_t value) {
+            const auto utxo = nlohmann::json::from_msgpack(value.begin(), value.end());
+            GDK_RUNTIME_ASSERT(utxo == get_utxo(std::stoul(asset_id)));
+            ++count;
+        });
+        GDK_RUNTIME_ASSERT(count == 5);
+
+        // Only present asset ids are returned
+        const std::vector<std::string> asset_ids{ "1", "3", "7" };
+        std::vector<std::string> found;
+        const auto add_found = [&found](const std::string& asset_id, byte_span_t) { found.push_back(asset_id); };
+        c.get_registry("index", asset_ids, add_found);
+        GDK_RUNTIME_ASSERT(found == std::vector<std::string>({ "1", "3" }));
+        found.clear();
+        c.get_registry("icons", asset_ids, add_found);
+        GDK_RUNTIME_ASSERT(found.empty());
+        GDK_RUNTIME_ASSERT(c.get_stats()["tables"]["asset_registry"]["hits"] == 3);
+
+        // Address scripts are keyed by subtype as well as type
+        cache::address_script_t value{ get_txhash(1), {}, {} };
+        value.ga_pub_key.fill(2);
+        value.user_pub_key.fill(3);
+        c.insert_address_script({ 1, 100, 1, 15, 65535 }, value);
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        const auto value = c.get_address_script({ 1, 100, 1, 15, 65535 });
+        GDK_RUNTIME_ASSERT(value && value->script == get_txhash(1));
+        GDK_RUNTIME_ASSERT(value->ga_pub_key[0] == 2 && value->user_pub_key[0] == 3);
+        GDK_RUNTIME_ASSERT(!c.get_address_script({ 1, 100, 1, 15, 144 }));
+        GDK_RUNTIME_ASSERT(!c.get_address_script({ 1, 101, 1, 15, 65535 }));
+
+        // Record outputs that failed to unblind, two of them for the same nonce
+        std::vector<cache::liquid_unblind_failure_t> failures;
+        for (uint32_t i = 0; i < 3; ++i) {
+            failures.push_back({ get_txhash(i), i, get_txhash(i / 2), get_txhash(i / 2 + 1) });
+        }
+        GDK_RUNTIME_ASSERT(c.insert_liquid_unblind_failures(failures) == 3);
+        GDK_RUNTIME_ASSERT(c.insert_liquid_unblind_failures(failures) == 0);
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        for (uint32_t i = 0; i < 3; ++i) {
+            GDK_RUNTIME_ASSERT(c.has_liquid_unblind_failure(get_txhash(i), i));
+        }
+        GDK_RUNTIME_ASSERT(!c.has_liquid_unblind_failure(get_txhash(3), 3));
+        GDK_RUNTIME_ASSERT(c.get_stats()["tables"]["liquid_unblind_failures"]["hits"] == 3);
+
+        // Setting the nonce forgets the failures that may now unblind
+        c.insert_liquid_blinding_nonce(get_txhash(0), get_txhash(1), get_txhash(2));
+        GDK_RUNTIME_ASSERT(!c.has_liquid_unblind_failure(get_txhash(0), 0));
+        GDK_RUNTIME_ASSERT(!c.has_liquid_unblind_failure(get_txhash(1), 1));
+        GDK_RUNTIME_ASSERT(c.has_liquid_unblind_failure(get_txhash(2), 2));
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        GDK_RUNTIME_ASSERT(!c.has_liquid_unblind_failure(get_txhash(0), 0));
+        GDK_RUNTIME_ASSERT(c.has_liquid_unblind_failure(get_txhash(2), 2));
+    }
+    {
+        // Outputs from the tx list are returned without their txhash. Once
+        // it is added, an output that failed to unblind is skipped the next
+        // time the tx list is fetched
+        const auto get_server_tx = [] {
+            nlohmann::json eps
+                = { { { "is_output", false }, { "pt_idx", 0 } }, { { "is_output", true }, { "pt_idx", 1 } } };
+            return nlohmann::json({ { "txhash", b2h(get_txhash(7)) }, { "eps", std::move(eps) } });
+        };
+        cache c(net_params, "liquid");
+        c.load_db(key, 1);
+        auto tx = get_server_tx();
+        add_tx_output_txhashes(tx);
+        GDK_RUNTIME_ASSERT(!tx["eps"][0].contains("txhash"));
+        const auto& failed = tx["eps"][1];
+        GDK_RUNTIME_ASSERT(failed.at("txhash") == b2h(get_txhash(7)));
+        GDK_RUNTIME_ASSERT(!c.has_liquid_unblind_failure(h2b(failed.at("txhash")), failed.at("pt_idx")));
+        const uint32_t pt_idx = failed.at("pt_idx");
+        const std::vector<cache::liquid_unblind_failure_t> failures{ { h2b(failed.at("txhash")), pt_idx,
+            get_txhash(8), get_txhash(9) } };
+        GDK_RUNTIME_ASSERT(c.insert_liquid_unblind_failures(failures) == 1);
+
+        auto refetched = get_server_tx();
+        add_tx_output_txhashes(refetched);
+        const auto& output = refetched["eps"][1];
+        GDK_RUNTIME_ASSERT(c.has_liquid_unblind_failure(h2b(output.at("txhash")), output.at("pt_idx")));
+    }
+
+    constexpr uint32_t NUM_SAVES = 100;
+    const auto check_value = [](cache& c, uint32_t expected) {
+        bool found = false;
+        c.get_key_value("counter", [&found, expected](boost::optional<byte_span_t> value) {
+            GDK_RUNTIME_ASSERT(value && value->size() == 1 && (*value)[0] == expected);
+            found = true;
+        });
+        GDK_RUNTIME_ASSERT(found);
+    };
+    {
+        // Save enough changes that the page log must be compacted, in a
+        // separate database so that it is small
+        cache c(net_params, "liquid");
+        c.load_db(key, 2);
+        for (uint32_t i = 0; i < NUM_SAVES; ++i) {
+            const std::array<unsigned char, 1> value{ static_cast<unsigned char>(i) };
+            c.upsert_key_value("counter", value);
+            c.save_db();
+            c.flush();
+        }
+        GDK_RUNTIME_ASSERT(c.get_stats()["writes"]["writes"] == NUM_SAVES);
+    }
+    {
+        // Every save, including those after compacting, was written
+        cache c(net_params, "liquid");
+        c.load_db(key, 2);
+        check_value(c, NUM_SAVES - 1);
+        const std::array<unsigned char, 1> value{ 0 };
+        c.upsert_key_value("counter", value);
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 2);
+        check_value(c, 0);
+    }
+
+    {
+        // Write a version 1 file, which holds the database image as a single
+        // encrypted blob, with a blinding nonce in it
+        sqlite3* db = nullptr;
+        GDK_RUNTIME_ASSERT(sqlite3_open(":memory:", &db) == SQLITE_OK);
+        const std::string sql = "CREATE TABLE LiquidBlindingNonce(pubkey BLOB NOT NULL, script BLOB NOT NULL, "
+                                "nonce BLOB NOT NULL, PRIMARY KEY(pubkey, script));"
+                                "INSERT INTO LiquidBlindingNonce VALUES (x'"
+            + b2h(get_txhash(1)) + "', x'" + b2h(get_txhash(2)) + "', x'" + b2h(get_txhash(3)) + "');";
+        GDK_RUNTIME_ASSERT(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK);
+        sqlite3_int64 image_size;
+        unsigned char* image = sqlite3_serialize(db, "main", &image_size, 0);
+        GDK_RUNTIME_ASSERT(image != nullptr);
+        const auto plaintext = gsl::make_span(image, image_size);
+        std::vector<unsigned char> cyphertext(aes_gcm_encrypt_get_length(plaintext));
+        GDK_RUNTIME_ASSERT(aes_gcm_encrypt(sha256(key), plaintext, cyphertext) == cyphertext.size());
+        sqlite3_free(image);
+        sqlite3_close(db);
+        std::ofstream f(get_db_path(key, 3, 1), std::ios::binary);
+        f.write(reinterpret_cast<const char*>(cyphertext.data()), cyphertext.size());
+    }
+    {
+        // Loading upgrades the file to the current version, keeping its contents
+        cache c(net_params, "liquid");
+        c.load_db(key, 3);
+        const auto nonce = c.get_liquid_blinding_nonce(get_txhash(1), get_txhash(2));
+        GDK_RUNTIME_ASSERT(nonce && *nonce == get_txhash(3));
+        GDK_RUNTIME_ASSERT(!file_exists(get_db_path(key, 3, 1)));
+        GDK_RUNTIME_ASSERT(file_exists(get_db_path(key, 3, 2)));
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 3);
+        const auto nonce = c.get_liquid_blinding_nonce(get_txhash(1), get_txhash(2));
+        GDK_RUNTIME_ASSERT(nonce && *nonce == get_txhash(3));
+    }
+
+    std::vector<cache::liquid_output_ref_t> unspent{ { get_txhash(0), 0, get_txhash(0), get_txhash(1) },
+        { get_txhash(5), 5, {}, {} } };
+    {
+        // Fill the cache past its limit, with two of the oldest outputs unspent
+        cache c(net_params, "liquid");
+        c.load_db(key, 4);
+        insert_outputs_bulk(c, 0, MAX_LIQUID_ROWS + 10);
+        std::vector<cache::liquid_blinding_nonce_t> nonces;
+        for (uint32_t i = 0; i < MAX_LIQUID_ROWS + 10; ++i) {
+            nonces.push_back({ get_txhash(i), get_txhash(i + 1), get_txhash(i + 2) });
+        }
+        GDK_RUNTIME_ASSERT(c.insert_liquid_blinding_nonces(nonces) == nonces.size());
+        GDK_RUNTIME_ASSERT(c.set_liquid_unspent_outputs(1, unspent));
+        GDK_RUNTIME_ASSERT(!c.set_liquid_unspent_outputs(1, unspent));
+        c.save_db();
+    }
+    {
+        // The oldest rows are evicted at load, except for the unspent
+        // outputs and their nonces
+        cache c(net_params, "liquid");
+        c.load_db(key, 4);
+        const auto stats = c.get_stats()["eviction"];
+        GDK_RUNTIME_ASSERT(stats["evicted_outputs"] == 8 && stats["evicted_nonces"] == 9);
+        GDK_RUNTIME_ASSERT(c.has_liquid_output(get_txhash(0), 0) && c.has_liquid_output(get_txhash(5), 5));
+        GDK_RUNTIME_ASSERT(!c.has_liquid_output(get_txhash(1), 1) && !c.has_liquid_output(get_txhash(9), 9));
+        check_outputs(c, MAX_LIQUID_ROWS + 10, 10);
+        GDK_RUNTIME_ASSERT(c.has_liquid_blinding_nonce(get_txhash(0), get_txhash(1)));
+        GDK_RUNTIME_ASSERT(!c.has_liquid_blinding_nonce(get_txhash(5), get_txhash(6)));
+
+        // Outputs spent elsewhere are dropped when the unspent outputs are
+        // next recorded, and outputs spent by us when they are evicted
+        unspent.erase(unspent.begin());
+        GDK_RUNTIME_ASSERT(c.set_liquid_unspent_outputs(1, unspent));
+        GDK_RUNTIME_ASSERT(c.evict_spent_liquid_outputs(unspent) == 1);
+        GDK_RUNTIME_ASSERT(!c.set_liquid_unspent_outputs(1, {}));
+        c.save_db();
+    }
+    {
+        cache c(net_params, "liquid");
+        c.load_db(key, 4);
+        GDK_RUNTIME_ASSERT(c.get_stats()["eviction"]["evicted_outputs"] == 1);
+        GDK_RUNTIME_ASSERT(!c.has_liquid_output(get_txhash(0), 0) && !c.has_liquid_output(get_txhash(5), 5));
+        check_outputs(c, MAX_LIQUID_ROWS + 10, 10);
+    }
+
+    return 0;
+}
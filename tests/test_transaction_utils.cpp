@@ -0,0 +1,49 @@
+#include "src/assertion.hpp"
+#include "src/transaction_utils.hpp"
+#include <nlohmann/json.hpp>
+
+using namespace ga::sdk;
+
+// Verify which formatted txs can be reused by later tx list requests
+
+namespace {
+nlohmann::json get_tx(const std::string& input_error, const std::string& output_error)
+{
+    nlohmann::json input = { { "is_output", false } }, output = { { "is_output", true } };
+    if (!input_error.empty()) {
+        input["error"] = input_error;
+    }
+    if (!output_error.empty()) {
+        output["error"] = output_error;
+    }
+    return { { "spv_verified", "disabled" }, { "inputs", { input } }, { "outputs", { output, output } } };
+}
+} // namespace
+
+int main()
+{
+    const std::string failed = "failed to unblind utxo";
+    const std::string missing_nonce = "missing blinding nonce";
+
+    GDK_RUNTIME_ASSERT(is_final_formatted_tx(get_tx(std::string(), std::string())));
+
+    // Failures to unblind are recorded and not retried, so don't block reuse
+    GDK_RUNTIME_ASSERT(is_final_formatted_tx(get_tx(std::string(), failed)));
+    GDK_RUNTIME_ASSERT(is_final_formatted_tx(get_tx(failed, failed)));
+
+    // Endpoints awaiting a nonce from the hardware wallet must be retried
+    GDK_RUNTIME_ASSERT(!is_final_formatted_tx(get_tx(std::string(), missing_nonce)));
+    GDK_RUNTIME_ASSERT(!is_final_formatted_tx(get_tx(missing_nonce, std::string())));
+    auto tx = get_tx(std::string(), failed);
+    tx["outputs"][1]["error"] = missing_nonce;
+    GDK_RUNTIME_ASSERT(!is_final_formatted_tx(tx));
+
+    // As must txs still being SPV verified
+    tx = get_tx(std::string(), std::string());
+    tx["spv_verified"] = "in_progress";
+    GDK_RUNTIME_ASSERT(!is_final_formatted_tx(tx));
+    tx["spv_verified"] = "verified";
+    GDK_RUNTIME_ASSERT(is_final_formatted_tx(tx));
+
+    return 0;
+}
@@ -0,0 +1,401 @@
+#include "src/boost_wrapper.hpp"
+#include "src/tx_list_cache.hpp"
+#include "src/utils.hpp"
+#include <nlohmann/json.hpp>
+#include <random>
+#include <thread>
+
+using namespace ga::sdk;
+
+// Verify the tx list cache against a fake server
+
+namespace {
+using container_type = tx_list_cache::container_type;
+
+constexpr int64_t START_TIME = 1577836800; // 2020-01-01 00:00:00
+
+std::string get_txhash(uint32_t i)
+{
+    char txhash[65];
+    snprintf(txhash, sizeof(txhash), "%064x", i);
+    return txhash;
+}
+
+// Format a time as the server does, using boost so that the cache's own date
+// parsing and formatting is checked against an independent implementation
+std::string get_created_at(int64_t t)
+{
+    using namespace boost::posix_time;
+    const ptime epoch(boost::gregorian::date(1970, 1, 1));
+    auto created_at = to_iso_extended_string(epoch + seconds(t));
+    created_at[10] = ' ';
+    return created_at;
+}
+
+int64_t parse_created_at(const std::string& created_at)
+{
+    using namespace boost::posix_time;
+    const ptime epoch(boost::gregorian::date(1970, 1, 1));
+    return (time_from_string(created_at) - epoch).total_seconds();
+}
+
+// Convert a query date "YYYY-MM-DDTHH:MM:SS.000Z" to the created_at format
+std::string from_query_date(const std::string& date)
+{
+    GDK_RUNTIME_ASSERT(date.size() == 24 && date[10] == 'T' && date.substr(19) == ".000Z");
+    auto created_at = date.substr(0, 19);
+    created_at[10] = ' ';
+    return created_at;
+}
+
+// Serialize a tx spending the given outputs, for the cache to read the
+// spends of mempool txs from
+std::string get_tx_hex(const std::vector<std::pair<uint32_t, uint32_t>>& spends)
+{
+    std::vector<unsigned char> tx{ 2, 0, 0, 0, static_cast<unsigned char>(spends.size()) };
+    for (const auto& spend : spends) {
+        const auto txhash = h2b_rev(get_txhash(spend.first));
+        tx.insert(tx.end(), txhash.begin(), txhash.end());
+        for (size_t i = 0; i < sizeof(uint32_t); ++i) {
+            tx.push_back((spend.second >> (i * 8)) & 0xff);
+        }
+        tx.insert(tx.end(), { 0, 0xff, 0xff, 0xff, 0xff });
+    }
+    tx.insert(tx.end(), { 1, 0xe8, 0x03, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
+    return b2h(tx);
+}
+
+// A server holding txs newest first, answering queries as the GA server does:
+// 30 txs per page, with start dates inclusive and end dates exclusive
+struct fake_server {
+    std::vector<nlohmann::json> txs;
+    uint32_t next_id = 1;
+    uint32_t block_height = 1000;
+    int64_t next_time = START_TIME;
+    std::atomic<size_t> calls{ 0 };
+    std::mutex mutex;
+    std::vector<std::string> end_dates;
+
+    uint32_t add_tx(bool is_confirmed, const std::vector<std::pair<uint32_t, uint32_t>>& spends = {})
+    {
+        const uint32_t id = next_id++;
+        nlohmann::json tx = { { "txhash", get_txhash(id) }, { "created_at", get_created_at(next_time) },
+            { "block_height", is_confirmed ? ++block_height : 0 } };
+        next_time += 600;
+        if (!is_confirmed) {
+            tx["data"] = get_tx_hex(spends);
+        }
+        txs.insert(txs.begin(), tx);
+        return id;
+    }
+
+    nlohmann::json& find(uint32_t id)
+    {
+        const auto txhash = get_txhash(id);
+        const auto p = std::find_if(
+            txs.begin(), txs.end(), [&txhash](const nlohmann::json& tx) { return tx["txhash"] == txhash; });
+        GDK_RUNTIME_ASSERT(p != txs.end());
+        return *p;
+    }
+
+    container_type get_txs(uint32_t page, const std::string& start_date, const std::string& end_date)
+    {
+        ++calls;
+        {
+            std::lock_guard<std::mutex> locker(mutex);
+            end_dates.push_back(end_date);
+        }
+        const std::string start = start_date.empty() ? std::string() : from_query_date(start_date);
+        const std::string end = end_date.empty() ? std::string() : from_query_date(end_date);
+        std::vector<const nlohmann::json*> matches;
+        for (const auto& tx : txs) {
+            const std::string& created_at = tx["created_at"];
+            if ((start.empty() || created_at >= start) && (end.empty() || created_at < end)) {
+                matches.push_back(&tx);
+            }
+        }
+        container_type result;
+        for (size_t i = page * 30; i < matches.size() && i < (page + 1) * 30; ++i) {
+            result.push_back(*matches[i]);
+        }
+        return result;
+    }
+
+    tx_list_cache::get_txs_fn_t get_fn()
+    {
+        return [this](uint32_t page, const std::string& start_date, const std::string& end_date,
+                   nlohmann::json& state_info) {
+            state_info["cur_block"] = block_height;
+            return get_txs(page, start_date, end_date);
+        };
+    }
+
+    // Check the txs returned from position 'first' match the server's
+    void check(const container_type& result, size_t first, size_t count) const
+    {
+        std::vector<std::string> expected;
+        for (const auto& tx : txs) {
+            if (!tx.contains("replaced_by")) {
+                expected.push_back(tx["txhash"]);
+            }
+        }
+        first = std::min(first, expected.size());
+        GDK_RUNTIME_ASSERT(result.size() == std::min(count, expected.size() - first));
+        for (size_t i = 0; i < result.size(); ++i) {
+            GDK_RUNTIME_ASSERT(result[i]["txhash"] == expected[first + i]);
+        }
+    }
+};
+
+// A persisted copy of a cache, as stored by ga_session
+struct persisted_txs {
+    std::map<int64_t, nlohmann::json> txs; // By ordinal
+    std::string oldest_txhash;
+
+    // Apply any changes, returning the number of txs written
+    size_t save(tx_list_cache& cache)
+    {
+        tx_list_changes changes;
+        if (!cache.get_changes(changes)) {
+            return 0;
+        }
+        for (auto it = txs.begin(); it != txs.end();) {
+            const bool is_kept = it->first >= changes.keep_min && it->first <= changes.keep_max;
+            it = is_kept ? std::next(it) : txs.erase(it);
+        }
+        for (const auto& tx : changes.txs) {
+            GDK_RUNTIME_ASSERT(txs.emplace(tx.first, nlohmann::json::from_msgpack(tx.second)).second);
+        }
+        oldest_txhash = changes.oldest_txhash;
+        return changes.txs.size();
+    }
+
+    void load(tx_list_cache& cache, uint32_t block_height) const
+    {
+        container_type newest_first;
+        for (auto it = txs.rbegin(); it != txs.rend(); ++it) {
+            newest_first.push_back(it->second);
+        }
+        cache.load(newest_first, txs.empty() ? 0 : txs.begin()->first, oldest_txhash, block_height);
+    }
+
+    // Persisted txs must be confirmed and have contiguous ordinals,
+    // matching a run of the server's txs
+    void check(const fake_server& server) const
+    {
+        if (txs.empty()) {
+            return;
+        }
+        GDK_RUNTIME_ASSERT(txs.rbegin()->first - txs.begin()->first + 1 == static_cast<int64_t>(txs.size()));
+        const auto& newest = txs.rbegin()->second["txhash"];
+        size_t i = 0;
+        while (i < server.txs.size() && server.txs[i]["txhash"] != newest) {
+            ++i;
+        }
+        for (auto it = txs.rbegin(); it != txs.rend(); ++it, ++i) {
+            GDK_RUNTIME_ASSERT(i < server.txs.size() && server.txs[i]["txhash"] == it->second["txhash"]);
+            GDK_RUNTIME_ASSERT(it->second["block_height"] != 0);
+        }
+    }
+};
+
+void test_ordinals()
+{
+    // Persisting a cache writes each tx once, under an ordinal that is
+    // fixed while the tx remains cached
+    fake_server server;
+    for (int i = 0; i < 100; ++i) {
+        server.add_tx(true);
+    }
+    persisted_txs persisted;
+    {
+        tx_list_cache cache(false, true, std::make_shared<tx_list_stats>());
+        server.check(cache.get(0, 50, server.get_fn()).first, 0, 50);
+        GDK_RUNTIME_ASSERT(persisted.save(cache) >= 50); // Whole pages are cached
+        GDK_RUNTIME_ASSERT(persisted.save(cache) == 0);
+        persisted.check(server);
+    }
+    const auto old_txs = persisted.txs;
+    for (int i = 0; i < 2; ++i) {
+        server.add_tx(true);
+    }
+    // Discard txs from the last REORG_BLOCKS blocks, as ga_session does
+    const uint32_t reorg_height = server.block_height - tx_list_cache::REORG_BLOCKS + 1;
+    {
+        tx_list_cache cache(false, true, std::make_shared<tx_list_stats>());
+        persisted.load(cache, reorg_height);
+        server.check(cache.get(0, 60, server.get_fn()).first, 0, 60);
+        // Only txs that were not kept are written, and kept txs retain their ordinals
+        size_t num_kept = 0;
+        for (const auto& tx : old_txs) {
+            num_kept += tx.second["block_height"] < reorg_height;
+        }
+        GDK_RUNTIME_ASSERT(num_kept != 0 && num_kept != old_txs.size());
+        const size_t num_written = persisted.save(cache);
+        GDK_RUNTIME_ASSERT(num_written == persisted.txs.size() - num_kept);
+        persisted.check(server);
+        for (const auto& tx : old_txs) {
+            if (tx.second["block_height"] < reorg_height) {
+                GDK_RUNTIME_ASSERT(persisted.txs.at(tx.first) == tx.second);
+            }
+        }
+
+        // Fetch the remaining txs, marking the history as complete
+        server.check(cache.get(0, 200, server.get_fn()).first, 0, 200);
+        persisted.save(cache);
+        persisted.check(server);
+        GDK_RUNTIME_ASSERT(persisted.txs.size() == server.txs.size());
+        GDK_RUNTIME_ASSERT(persisted.oldest_txhash == server.txs.back()["txhash"]);
+    }
+    {
+        // A warm restart only fetches the newest txs
+        tx_list_cache cache(false, true, std::make_shared<tx_list_stats>());
+        persisted.load(cache, reorg_height);
+        server.calls = 0;
+        server.check(cache.get(0, 200, server.get_fn()).first, 0, 200);
+        GDK_RUNTIME_ASSERT(server.calls == 1);
+    }
+}
+void test_targeted_invalidation()
+{
+    // With targeted invalidation, a new tx only removes the cached txs it
+    // spends from or double spends, and those newer than them
+    fake_server server;
+    for (int i = 0; i < 50; ++i) {
+        server.add_tx(true);
+    }
+    const uint32_t unrelated = server.add_tx(false, { { 10, 1 } });
+    uint32_t chain = server.add_tx(false, { { 50, 0 } });
+    for (int i = 0; i < 3; ++i) {
+        chain = server.add_tx(false, { { chain, 0 } });
+    }
+
+    auto stats = std::make_shared<tx_list_stats>();
+    tx_list_cache cache(false, true, stats);
+    server.check(cache.get(0, 100, server.get_fn()).first, 0, 100);
+
+    auto on_new_tx = [&](uint32_t id, size_t expected_evictions, size_t expected_calls) {
+        const uint64_t evicted = stats->evicted_txs;
+        cache.on_new_transaction({ { "txhash", get_txhash(id) } });
+        server.calls = 0;
+        server.check(cache.get(0, 100, server.get_fn()).first, 0, 100);
+        GDK_RUNTIME_ASSERT(stats->evicted_txs - evicted == expected_evictions);
+        GDK_RUNTIME_ASSERT(server.calls == expected_calls);
+    };
+
+    // A tx spending a confirmed output removes nothing
+    const uint32_t newest = server.add_tx(false, { { 20, 1 } });
+    on_new_tx(newest, 0, 1);
+
+    // A tx spending the end of a chain of mempool txs removes only the
+    // spent tx and newer txs. Refetching them must not remove the rest of
+    // the chain one tx at a time
+    on_new_tx(server.add_tx(false, { { chain, 0 } }), 2, 2);
+
+    // A double spend removes the replaced tx and all newer txs
+    const uint32_t double_spend = server.add_tx(false, { { 10, 1 } });
+    server.find(unrelated)["replaced_by"] = get_txhash(double_spend);
+    on_new_tx(double_spend, 7, 2);
+
+    // A confirmed tx is refetched along with all newer txs
+    server.find(chain)["block_height"] = ++server.block_height;
+    cache.on_new_transaction({ { "txhash", get_txhash(chain) } });
+    server.check(cache.get(0, 100, server.get_fn()).first, 0, 100);
+    const auto result = cache.get(0, 100, server.get_fn()).first;
+    GDK_RUNTIME_ASSERT(std::find_if(result.begin(), result.end(), [&chain](const nlohmann::json& tx) {
+        return tx["txhash"] == get_txhash(chain) && tx["block_height"] != 0;
+    }) != result.end());
+}
+void test_sync_all()
+{
+    // Fetching the whole history in date windows must return every tx once,
+    // in order, whatever the earliest time given
+    fake_server server;
+    for (int i = 0; i < 1000; ++i) {
+        server.add_tx(true);
+    }
+    // Some txs share a timestamp, which may fall on a window boundary
+    for (size_t i = 0; i + 1 < server.txs.size(); i += 7) {
+        server.txs[i]["created_at"] = server.txs[i + 1]["created_at"];
+    }
+    const int64_t end_time = server.next_time;
+    for (const int64_t earliest_time : { int64_t(0), START_TIME, START_TIME + 12345, end_time - 1800, end_time }) {
+        tx_list_cache cache(false, true, std::make_shared<tx_list_stats>());
+        server.check(cache.get(0, 45, server.get_fn()).first, 0, 45);
+
+        std::vector<std::thread> threads;
+        const auto post = [&threads](std::function<void()> task) { threads.emplace_back(std::move(task)); };
+        nlohmann::json state_info = { { "cur_block", 0u }, { "fiat_exchange", nullptr } };
+        cache.sync_all(earliest_time, state_info, server.get_fn(), 4, post);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        GDK_RUNTIME_ASSERT(state_info["cur_block"] == server.block_height);
+
+        // Everything is cached, with contiguous ordinals
+        server.calls = 0;
+        server.check(cache.get(0, 2000, server.get_fn()).first, 0, 2000);
+        GDK_RUNTIME_ASSERT(server.calls == 0);
+        persisted_txs persisted;
+        persisted.save(cache);
+        persisted.check(server);
+        GDK_RUNTIME_ASSERT(persisted.txs.size() == server.txs.size());
+        GDK_RUNTIME_ASSERT(persisted.oldest_txhash == server.txs.back()["txhash"]);
+    }
+}
+void test_dates()
+{
+    // Tx dates are parsed and query dates formatted without boost; compare
+    // them against boost over the range of dates the server can return
+    std::mt19937_64 rng(19);
+    std::uniform_int_distribution<int64_t> dist(0, 253402300799); // To 9999-12-31 23:59:59
+    for (int i = 0; i < 100000; ++i) {
+        const int64_t t = dist(rng);
+        auto created_at = get_created_at(t);
+        if (i % 2) {
+            created_at += ".123456"; // Fractional seconds are ignored
+        }
+        GDK_RUNTIME_ASSERT(parse_created_at(created_at) == t);
+        const nlohmann::json tx = { { "txhash", get_txhash(1) }, { "created_at", created_at } };
+        GDK_RUNTIME_ASSERT(tx_list_cache::get_cursor(tx).created_at == t);
+    }
+    // Other formats fall back to boost
+    for (const std::string created_at : { "2020-Jan-02 03:04:05", "2020-1-2 3:04:05" }) {
+        const nlohmann::json tx = { { "txhash", get_txhash(1) }, { "created_at", created_at } };
+        GDK_RUNTIME_ASSERT(tx_list_cache::get_cursor(tx).created_at == parse_created_at(created_at));
+    }
+
+    // Fetching txs older than a cached tx queries for txs before the second
+    // following it, which may be in the next day, month, year or century
+    const std::vector<std::pair<std::string, std::string>> cases = {
+        { "1969-12-31 23:59:59", "1970-01-01T00:00:00.000Z" },
+        { "2019-12-31 23:59:59", "2020-01-01T00:00:00.000Z" },
+        { "2020-02-28 23:59:59", "2020-02-29T00:00:00.000Z" },
+        { "2020-02-29 23:59:59", "2020-03-01T00:00:00.000Z" },
+        { "2100-02-28 23:59:59", "2100-03-01T00:00:00.000Z" },
+        { "2023-06-30 12:34:56", "2023-06-30T12:34:57.000Z" },
+    };
+    for (const auto& c : cases) {
+        // Put the oldest tx of the first page at the given time
+        fake_server server;
+        server.next_time = parse_created_at(c.first) - 5 * 600;
+        for (int i = 0; i < 35; ++i) {
+            server.add_tx(true);
+        }
+        tx_list_cache cache(false, true, std::make_shared<tx_list_stats>());
+        server.check(cache.get(0, 30, server.get_fn()).first, 0, 30);
+        GDK_RUNTIME_ASSERT(server.txs[29]["created_at"] == c.first);
+        server.check(cache.get(0, 35, server.get_fn()).first, 0, 35);
+        GDK_RUNTIME_ASSERT(server.end_dates.back() == c.second);
+    }
+}
+} // namespace
+
+int main()
+{
+    test_ordinals();
+    test_targeted_invalidation();
+    test_sync_all();
+    test_dates();
+    return 0;
+}